@@ -115,6 +115,61 @@ def generate_pivot(the_data,x, y, z):
 
     return(x, y, z)
 
+############ dense grids written by the solver ############
+
+# read the gridsL*.bin file of a run: a dict from grid name
+# to (values, axes), with axes a list of (axis name, axis values)
+def load_grids(file_name):
+
+    grids = {}
+
+    with open(file_name, mode="rb") as the_file:
+        buf = the_file.read()
+
+    if buf[0:8] != b"SDGRIDS\0":
+        raise Exception("Not a grid file: " + file_name)
+
+    ngrids = int(np.frombuffer(buf, dtype=np.int32, count=1, offset=8)[0])
+    pos = 12
+
+    for grid_i in range(0, ngrids):
+        name = buf[pos:pos+16].rstrip(b"\0").decode()
+        dtype = np.dtype(buf[pos+16:pos+24].rstrip(b"\0").decode())
+        ndim = int(np.frombuffer(buf, dtype=np.int32, count=1, offset=pos+24)[0])
+        pos += 28
+
+        axes = []
+
+        for axis_i in range(0, ndim):
+            axis_name = buf[pos:pos+8].rstrip(b"\0").decode()
+            n = int(np.frombuffer(buf, dtype=np.int32, count=1, offset=pos+8)[0])
+            axes += [(axis_name, np.frombuffer(buf, dtype=np.int32, count=n, offset=pos+12))]
+            pos += 12 + 4 * n
+
+        shape = tuple(len(values) for (axis_name, values) in axes)
+        count = int(np.prod(shape))
+
+        grids[name] = (np.frombuffer(buf, dtype=dtype, count=count, offset=pos).reshape(shape), axes)
+        pos += count * dtype.itemsize
+
+    return(grids)
+
+# hormone over t (columns) and ts (rows) at damage d,
+# laid out as generate_pivot() does
+def hormone_pivot(d):
+
+    if grids is None:
+        return(generate_pivot(stress_data[stress_data["d"] == d]
+                ,x="t"
+                ,y="ts"
+                ,z="hormone"))
+
+    values, axes = grids["hormone"]
+
+    x, y = np.meshgrid(axes[2][1], axes[0][1])
+
+    return(x, y, values[:, list(axes[1][1]).index(d), :])
+
 
 
 #### get the stress_data file name
@@ -145,16 +200,33 @@ if "maxTs" in pardict.keys():
 
 
 ##### read in the data #####
-skiprows=2
 
-stress_data = pd.read_csv(filepath_or_buffer=file_name
-        ,sep="\t"
-        ,skiprows=skiprows
-        ,nrows=end_line-skiprows)
+# the grids written alongside by the solver spare
+# reading and pivoting the whole strategy table
+file_name_grids = re.sub(
+        pattern=r"stressL(.*)\.txt$"
+        ,repl=r"gridsL\1.bin"
+        ,string=file_name)
+
+grids = None
+stress_data = None
 
-# get all the damage values
-damage_vals = list(stress_data["d"].unique())
-damage_vals.sort()
+if os.path.exists(file_name_grids):
+    grids = load_grids(file_name_grids)
+
+    # get all the damage values
+    damage_vals = [int(d) for d in grids["hormone"][1][1][1]]
+else:
+    skiprows=2
+
+    stress_data = pd.read_csv(filepath_or_buffer=file_name
+            ,sep="\t"
+            ,skiprows=skiprows
+            ,nrows=end_line-skiprows)
+
+    # get all the damage values
+    damage_vals = list(stress_data["d"].unique())
+    damage_vals.sort()
 
 damage_filter = [0,0.25, 0.5,0.75,1]
 
@@ -227,14 +299,9 @@ if seasonal:
                 row=rowctr
                 ,col=0)
 
-        stress_subset = stress_data[stress_data["d"] == d_i].copy(deep=True)
-
         # make pivot table to fit 
         # the imshow or contourplot
-        (x, y, z) = generate_pivot(stress_subset
-                ,x="t"
-                ,y="ts"
-                ,z="hormone")
+        (x, y, z) = hormone_pivot(d_i)
 
         imshow_colorset = the_axis.imshow(z,
                     extent=[x.min(),
@@ -287,10 +354,10 @@ else:
 
     for d_i in damage_val_select:
         
-        d_sub = stress_data[stress_data["d"] == d_i]
+        (x, y, z) = hormone_pivot(d_i)
 
-        the_axis.plot(d_sub["t"]
-                ,d_sub["hormone"]
+        the_axis.plot(x[0]
+                ,z[0]
                 ,label=r"$d = " + str(d_i) + "$"
                 )
 
@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""Thin ctypes wrapper of libstress_damage.so (see stress_damage_api.h).
+
+    import stress_damage
+    m = stress_damage.Model(0.095, 0.005, Kmort=0.01)
+    m.solve()
+    m.forward()
+    m.hormone[50, 0, :]   # NumPy views of the solver's own arrays, no copies
+
+    k = stress_damage.Model(0.095, 0.005, Kmort=0.0)
+    k.solve()
+    stress_damage.compare(m, k, n=10000)["repro"]["diff"]   # paired, on common random numbers
+
+The arrays are read-only views that stay valid until the model is solved
+again or closed; take a copy to keep one beyond that.
+"""
+
+import ctypes
+import os.path
+
+import numpy as np
+
+_lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), "libstress_damage.so"))
+
+API_VERSION = 2
+
+HORMONE, W, F, SIM = 0, 1, 2, 3
+
+
+class Params(ctypes.Structure):
+    _fields_ = [
+        ("pLeave", ctypes.c_double),
+        ("pArrive", ctypes.c_double),
+        ("pAttack", ctypes.c_double),
+        ("alpha", ctypes.c_double),
+        ("Kmort", ctypes.c_double),
+        ("Kfec", ctypes.c_double),
+        ("maxT", ctypes.c_int),
+        ("maxTs", ctypes.c_int),
+        ("maxD", ctypes.c_int),
+        ("maxH", ctypes.c_int),
+        ("threads", ctypes.c_int),
+        ("mixed", ctypes.c_int),
+        ("gaussSeidel", ctypes.c_int),
+        ("blocked", ctypes.c_int),
+        ("tileT", ctypes.c_int),
+    ]
+
+
+class Paired(ctypes.Structure):
+    _fields_ = [
+        ("meanA", ctypes.c_double),
+        ("meanB", ctypes.c_double),
+        ("diff", ctypes.c_double),
+        ("se", ctypes.c_double),
+        ("lo", ctypes.c_double),
+        ("hi", ctypes.c_double),
+        ("seUnpaired", ctypes.c_double),
+    ]
+
+
+_lib.sd_version.restype = ctypes.c_int
+_lib.sd_default_params.argtypes = [ctypes.POINTER(Params)]
+_lib.sd_create.argtypes = [ctypes.POINTER(Params)]
+_lib.sd_create.restype = ctypes.c_void_p
+_lib.sd_destroy.argtypes = [ctypes.c_void_p]
+_lib.sd_solve.argtypes = [ctypes.c_void_p]
+_lib.sd_forward.argtypes = [ctypes.c_void_p]
+_lib.sd_simulate.argtypes = [ctypes.c_void_p, ctypes.c_uint]
+_lib.sd_compare.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_long, ctypes.c_uint,
+        ctypes.POINTER(Paired), ctypes.POINTER(Paired)]
+_lib.sd_iterations.argtypes = [ctypes.c_void_p]
+_lib.sd_pred_deaths.argtypes = [ctypes.c_void_p]
+_lib.sd_pred_deaths.restype = ctypes.c_double
+_lib.sd_damage_deaths.argtypes = [ctypes.c_void_p]
+_lib.sd_damage_deaths.restype = ctypes.c_double
+_lib.sd_array.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_int),
+        ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_ssize_t)]
+_lib.sd_array.restype = ctypes.c_void_p
+_lib.sd_last_error.restype = ctypes.c_char_p
+
+if _lib.sd_version() != API_VERSION:
+    raise ImportError("libstress_damage.so has API version " + str(_lib.sd_version())
+            + ", this wrapper expects " + str(API_VERSION))
+
+
+class Model:
+    """One model of the seasonal solver; keyword arguments are fields of Params."""
+
+    def __init__(self, pLeave, pArrive, **kwargs):
+        params = Params()
+        _lib.sd_default_params(ctypes.byref(params))
+        params.pLeave = pLeave
+        params.pArrive = pArrive
+
+        for name, value in kwargs.items():
+            setattr(params, name, value)
+
+        self.params = params
+        self._m = _lib.sd_create(ctypes.byref(params))
+
+        if not self._m:
+            raise ValueError(_lib.sd_last_error().decode())
+
+    def close(self):
+        if self._m:
+            _lib.sd_destroy(self._m)
+            self._m = None
+
+    def __del__(self):
+        self.close()
+
+    def solve(self):
+        """Find the optimal strategy; returns whether it converged, and raises
+        RuntimeError if it was given up as diverging or stagnant."""
+        status = _lib.sd_solve(self._m)
+        if status < 0:
+            raise RuntimeError(_lib.sd_last_error().decode())
+        return status == 0
+
+    def forward(self):
+        """Forward calculation of the solved strategy."""
+        if _lib.sd_forward(self._m) != 0:
+            raise RuntimeError(_lib.sd_last_error().decode())
+
+    def simulate(self, seed=0):
+        """Simulate one individual through a run of attacks; returns the rows."""
+        if _lib.sd_simulate(self._m, seed) < 0:
+            raise RuntimeError(_lib.sd_last_error().decode())
+        return self._array(SIM, np.int32)
+
+    @property
+    def iterations(self):
+        return _lib.sd_iterations(self._m)
+
+    @property
+    def pred_deaths(self):
+        return _lib.sd_pred_deaths(self._m)
+
+    @property
+    def damage_deaths(self):
+        return _lib.sd_damage_deaths(self._m)
+
+    @property
+    def hormone(self):
+        return self._array(HORMONE, np.int32)
+
+    @property
+    def W(self):
+        return self._array(W, np.float64)
+
+    @property
+    def F(self):
+        return self._array(F, np.float64)
+
+    def _array(self, which, dtype):
+        """Read-only view of array `which`, laid out as the solver stores it."""
+        ndim = ctypes.c_int()
+        shape = (ctypes.c_size_t * 4)()
+        strides = (ctypes.c_ssize_t * 4)()
+
+        p = _lib.sd_array(self._m, which, ctypes.byref(ndim), shape, strides)
+
+        if not p:
+            return None
+
+        shape = tuple(shape[:ndim.value])
+        strides = tuple(strides[:ndim.value])
+        extent = 1 + sum((n - 1) * s for n, s in zip(shape, strides)) // np.dtype(dtype).itemsize
+
+        flat = np.ctypeslib.as_array(ctypes.cast(p, ctypes.POINTER(np.ctypeslib.as_ctypes_type(dtype))), shape=(extent,))
+        view = np.lib.stride_tricks.as_strided(flat, shape=shape, strides=strides, writeable=False)
+
+        # keep the model, and so its memory, alive as long as the view
+        return _View(view, self)
+
+
+def compare(a, b, n=10000, seed=0):
+    """Simulate n lives under each of the solved models a and b, life k of both
+    on the same random numbers; returns the paired comparison of the reproductive
+    output ("repro") and the lifespan ("lifespan") of a life, each a dict of
+    meanA, meanB, diff (a - b), se, lo, hi (95% interval) and seUnpaired."""
+    repro = Paired()
+    lifespan = Paired()
+
+    if _lib.sd_compare(a._m, b._m, n, seed, ctypes.byref(repro), ctypes.byref(lifespan)) != 0:
+        raise RuntimeError(_lib.sd_last_error().decode())
+
+    return {name: {field: getattr(value, field) for field, _ in Paired._fields_}
+            for name, value in (("repro", repro), ("lifespan", lifespan))}
+
+
+class _View(np.ndarray):
+    """ndarray that holds on to the model its memory belongs to."""
+
+    def __new__(cls, array, model):
+        obj = array.view(cls)
+        obj._model = model
+        return obj
+
+    def __array_finalize__(self, obj):
+        self._model = getattr(obj, "_model", None)
@@ -0,0 +1,277 @@
+// **********************************************************************************
+// C API of libstress_damage.so, on top of the engine in stress_damage_lh.hpp.
+// **********************************************************************************
+
+#include "stress_damage_lh.hpp"
+#include "stress_damage_api.h"
+
+struct sd_model
+{
+    Model model;
+    int threads;      // threads sharing the sweeps
+};
+
+std::mutex apiLock;       // the engine works on global state, so calls take turns
+std::string lastError;    // message of sd_last_error()
+
+
+/* RUN THE ENGINE ON THE THREADS OF m */
+void UseThreads(sd_model *m)
+{
+    if (team.n == std::max(1, std::min(m->threads, m->model.maxT - 1))) return;
+
+    if (team.n > 0) TeamStop();
+
+    ::maxT = m->model.maxT; // TeamStart() sizes the team to the grid
+    TeamStart(m->threads, std::vector<int>());
+} // end UseThreads()
+
+
+extern "C" {
+
+int sd_version(void)
+{
+    return SD_API_VERSION;
+}
+
+
+void sd_default_params(sd_params *p)
+{
+    p->pLeave = 0.095;
+    p->pArrive = 0.005;
+    p->pAttack = 0.5;
+    p->alpha = 1.0;
+    p->Kmort = 0.0;
+    p->Kfec = 0.05;
+    p->maxT = 100;
+    p->maxTs = 10;
+    p->maxD = 20;
+    p->maxH = 500;
+    p->threads = 1;
+    p->mixed = 0;
+    p->gaussSeidel = 0;
+    p->blocked = 0;
+    p->tileT = 8;
+}
+
+
+sd_model *sd_create(const sd_params *p)
+{
+    std::lock_guard<std::mutex> hold(apiLock);
+    sd_model *m;
+
+    const double q[6] = {p->pLeave, p->pArrive, p->pAttack, p->alpha, p->Kmort, p->Kfec};
+
+    if (!CheckParams(q).empty())
+    {
+        lastError = CheckParams(q);
+        return NULL;
+    }
+
+    if (p->maxT < 2 || p->maxTs < 1 || p->maxD < 1 || p->maxH < 1 || p->threads < 1 || p->tileT < 1)
+    {
+        lastError = "grid extents, threads and tileT must be positive, and maxT at least 2";
+        return NULL;
+    }
+
+    m = new sd_model;
+    m->model.pLeave = p->pLeave;
+    m->model.pArrive = p->pArrive;
+    m->model.pAttack = p->pAttack;
+    m->model.alpha = p->alpha;
+    m->model.Kmort = p->Kmort;
+    m->model.Kfec = p->Kfec;
+    m->model.maxT = p->maxT;
+    m->model.maxTs = p->maxTs;
+    m->model.maxD = p->maxD;
+    m->model.maxH = p->maxH;
+    m->model.precision = p->mixed ? "mixed" : "double";
+    m->model.inPlace = p->gaussSeidel != 0;
+    m->model.blocked = p->blocked != 0;
+    m->model.tileT = p->tileT;
+    m->model.arena.base = NULL;
+    m->model.arena.capacity = 0;
+    m->model.arena.used = 0;
+    m->model.arena.hugetlb = false;
+    m->model.arena.fd = -1;
+    m->model.arena.clean = 0;
+    m->model.solved = false;
+    m->model.converged = false;
+    m->model.forward = false;
+    m->model.i = 0;
+    m->model.totfitdiff = 0.0;
+    m->model.predDeaths = 0.0;
+    m->model.damageDeaths = 0.0;
+    m->model.meanT = 0.0;
+    m->model.fwdMark = 0;
+    m->threads = p->threads;
+
+    return m;
+}
+
+
+void sd_destroy(sd_model *m)
+{
+    std::lock_guard<std::mutex> hold(apiLock);
+
+    if (m == NULL) return;
+
+    ModelFree(m->model);
+    delete m;
+}
+
+
+int sd_solve(sd_model *m)
+{
+    std::lock_guard<std::mutex> hold(apiLock);
+
+    UseThreads(m);
+    ModelSolve(m->model);
+
+    if (!m->model.solved)
+    {
+        lastError = failKind + ": " + failDetail;
+        return -1;
+    }
+
+    return m->model.converged ? 0 : 1;
+}
+
+
+int sd_forward(sd_model *m)
+{
+    std::lock_guard<std::mutex> hold(apiLock);
+
+    if (!m->model.solved)
+    {
+        lastError = "the model has not been solved";
+        return -1;
+    }
+
+    UseThreads(m);
+    ModelForward(m->model);
+
+    return 0;
+}
+
+
+int sd_simulate(sd_model *m, unsigned int seed)
+{
+    std::lock_guard<std::mutex> hold(apiLock);
+
+    if (!m->model.solved)
+    {
+        lastError = "the model has not been solved";
+        return -1;
+    }
+
+    UseThreads(m);
+
+    return ModelSimulate(m->model, seed);
+}
+
+
+int sd_compare(sd_model *a, sd_model *b, long n, unsigned int seed, sd_paired *repro, sd_paired *lifespan)
+{
+    std::lock_guard<std::mutex> hold(apiLock);
+    std::vector<Life> livesA,livesB;
+    PairedStat r,l;
+
+    if (!a->model.solved || !b->model.solved)
+    {
+        lastError = "both models must be solved";
+        return -1;
+    }
+
+    if (n < 2)
+    {
+        lastError = "at least two lives are needed for a confidence interval";
+        return -1;
+    }
+
+    UseThreads(a);
+    ModelLives(a->model, seed, n, livesA);
+
+    UseThreads(b);
+    ModelLives(b->model, seed, n, livesB);
+
+    ComparePaired(livesA, livesB, r, l);
+
+    *repro = {r.meanA, r.meanB, r.diff, r.se, r.lo, r.hi, r.seUnpaired};
+    *lifespan = {l.meanA, l.meanB, l.diff, l.se, l.lo, l.hi, l.seUnpaired};
+
+    return 0;
+}
+
+
+int sd_iterations(const sd_model *m)
+{
+    return m->model.i;
+}
+
+
+double sd_pred_deaths(const sd_model *m)
+{
+    return m->model.predDeaths;
+}
+
+
+double sd_damage_deaths(const sd_model *m)
+{
+    return m->model.damageDeaths;
+}
+
+
+const void *sd_array(const sd_model *m, int which, int *ndim, size_t *shape, ptrdiff_t *strides)
+{
+    const Model &M = m->model;
+    const Tensor4<double> *A;
+
+    if (which == SD_HORMONE && M.solved)
+    {
+        *ndim = 3;
+        shape[0] = M.maxT;
+        shape[1] = M.maxTs;
+        shape[2] = M.maxD + 1;
+        strides[0] = M.hormone.s0 * sizeof(int);
+        strides[1] = M.hormone.s1 * sizeof(int);
+        strides[2] = sizeof(int);
+        return M.hormone.data;
+    }
+
+    if ((which == SD_W && M.solved) || (which == SD_F && M.forward))
+    {
+        A = which == SD_W ? &M.S.W : &M.S.F;
+
+        *ndim = 4;
+        shape[0] = M.maxT;
+        shape[1] = M.maxTs;
+        shape[2] = M.maxD + 1;
+        shape[3] = M.maxH;
+        strides[0] = A->sT * sizeof(double);
+        strides[1] = A->sTs * sizeof(double);
+        strides[2] = A->sD * sizeof(double);
+        strides[3] = sizeof(double);
+        return A->data;
+    }
+
+    if (which == SD_SIM && !M.sim.empty())
+    {
+        *ndim = 2;
+        shape[0] = M.sim.size() / simColumns;
+        shape[1] = simColumns;
+        strides[0] = simColumns * sizeof(int);
+        strides[1] = sizeof(int);
+        return &M.sim[0];
+    }
+
+    return NULL;
+}
+
+
+const char *sd_last_error(void)
+{
+    return lastError.c_str();
+}
+
+} // extern "C"
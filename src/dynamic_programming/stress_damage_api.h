@@ -0,0 +1,117 @@
+/* **********************************************************************************
+ * C API of libstress_damage.so: the seasonal model of stress_damage_lh.cpp as a
+ * library, so that scripts can solve and inspect models without spawning the
+ * program and parsing its output files.
+ *
+ * A model is created from a parameter struct, solved, and optionally run forward
+ * and simulated; its results are then read in place through sd_array(). Calls
+ * may come from any thread but are carried out one at a time.
+ * ********************************************************************************** */
+
+#ifndef STRESS_DAMAGE_API_H
+#define STRESS_DAMAGE_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SD_API_VERSION 2
+
+/* the library is built with hidden visibility; these are all it exports */
+#if defined(__GNUC__)
+#define SD_EXPORT __attribute__((visibility("default")))
+#else
+#define SD_EXPORT
+#endif
+
+typedef struct sd_model sd_model;
+
+typedef struct sd_params
+{
+    double pLeave;    /* probability that predator leaves */
+    double pArrive;   /* probability that predator arrives */
+    double pAttack;   /* probability that predator attacks if present */
+    double alpha;     /* effect of hormone level on pKilled */
+    double Kmort;     /* increase in mortality with damage level */
+    double Kfec;      /* decrease in fecundity with damage level */
+    int maxT;         /* time steps since last saw predator */
+    int maxTs;        /* duration of a season */
+    int maxD;         /* maximum damage level */
+    int maxH;         /* maximum hormone level */
+    int threads;      /* threads sharing the sweeps */
+    int mixed;        /* nonzero: solve in single precision first, then polish in double */
+    int gaussSeidel;  /* nonzero: update in place */
+    int blocked;      /* nonzero: store each ts slice of W and F contiguously */
+    int tileT;        /* t rows searched and then filled in one go */
+} sd_params;
+
+/* paired comparison of one outcome under two strategies, see sd_compare() */
+typedef struct sd_paired
+{
+    double meanA;       /* mean under the strategy of a */
+    double meanB;       /* mean under the strategy of b */
+    double diff;        /* mean of the paired differences a - b */
+    double se;          /* its standard error */
+    double lo, hi;      /* 95% confidence interval of diff */
+    double seUnpaired;  /* standard error diff would have had with independent draws */
+} sd_paired;
+
+/* arrays of sd_array() */
+enum
+{
+    SD_HORMONE = 0,   /* int [maxT][maxTs][maxD+1]: optimal hormone level */
+    SD_W = 1,         /* double [maxT][maxTs][maxD+1][maxH]: expected fitness */
+    SD_F = 2,         /* double [maxT][maxTs][maxD+1][maxH]: frequencies of the forward calculation */
+    SD_SIM = 3        /* int [rows][7]: time, t, ts, damage, hormone, attack, reproduce */
+};
+
+/* SD_API_VERSION of the library */
+SD_EXPORT int sd_version(void);
+
+/* fill p with the defaults of stress_damage_lh.exe */
+SD_EXPORT void sd_default_params(sd_params *p);
+
+/* new model; NULL if p is invalid, see sd_last_error() */
+SD_EXPORT sd_model *sd_create(const sd_params *p);
+
+/* free a model and everything sd_array() has handed out for it */
+SD_EXPORT void sd_destroy(sd_model *m);
+
+/* find the optimal strategy; 0 if it converged, 1 if it did not, -1 if it was given up as
+   diverging or stagnant or its arrays could not be mapped, see sd_last_error() */
+SD_EXPORT int sd_solve(sd_model *m);
+
+/* forward calculation of the solved strategy; 0, or -1 if the model is not solved */
+SD_EXPORT int sd_forward(sd_model *m);
+
+/* simulate one individual through a run of attacks; number of rows, or -1 if the model is not solved */
+SD_EXPORT int sd_simulate(sd_model *m, unsigned int seed);
+
+/* simulate n lives under each of the solved models a and b, life k of both on the same
+   random numbers, and compare them pairwise: the reproductive output of a life in repro,
+   its lifespan in steps in lifespan. Each life is lived in the parameters of its own model,
+   which may differ in any of them. 0, or -1 if a model is not solved or n < 2 */
+SD_EXPORT int sd_compare(sd_model *a, sd_model *b, long n, unsigned int seed, sd_paired *repro, sd_paired *lifespan);
+
+/* value iterations of the last solve */
+SD_EXPORT int sd_iterations(const sd_model *m);
+
+/* per-time-step deaths from predation and from damage in the forward calculation */
+SD_EXPORT double sd_pred_deaths(const sd_model *m);
+SD_EXPORT double sd_damage_deaths(const sd_model *m);
+
+/* start of array `which` of m, or NULL if it has not been computed. ndim, shape and
+   strides (in bytes) describe it, so that it can be read in place whatever the layout.
+   It stays valid until the model is solved again or destroyed */
+SD_EXPORT const void *sd_array(const sd_model *m, int which, int *ndim, size_t *shape, ptrdiff_t *strides);
+
+/* why the last call failed */
+SD_EXPORT const char *sd_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRESS_DAMAGE_API_H */
@@ -0,0 +1,171 @@
+// **********************************************************************************
+// Check of the packed strategy formats, run by make check: the strategy of a
+// point solved by stress_damage_lh.exe, as written to the rows of stressL*.txt,
+// must come back unchanged from its stratL*.sdp file (stress_damage_codec.h)
+// and from a plain and a packed strategy store (stress_damage_store.h).
+//
+// Usage: stress_damage_check.exe stressL*.txt stratL*.sdp PLAIN.sds PACKED.sds
+// **********************************************************************************
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstdlib>
+#include <algorithm>
+
+#include "stress_damage_store.h"
+
+int nFailed = 0; // checks that did not hold
+
+
+/* REPORT WHETHER A CHECK HELD */
+void Expect(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "ok      " : "FAILED  ") << what << std::endl;
+
+    if (!ok) ++nFailed;
+} // end Expect()
+
+
+/* READ hormone[t][ts][d], INDEXED AS IN THE CODEC, AND nIterations FROM THE ROWS OF A stressL*.txt FILE
+   OF THE SEASONAL MODEL; returns whether every row was there */
+bool ReadRows(const char *path, const sd_pack_header &h, std::vector<int32_t> &levels, int &iterations)
+{
+    int t,d,ts,level;
+    size_t rows;
+    std::string line,name;
+    std::ifstream in(path);
+
+    levels.assign(size_t(h.maxT)*h.maxTs*(h.maxD+1), -1);
+    rows = 0;
+    iterations = -1;
+
+    // the rows follow their header line and end at a blank line
+    while (std::getline(in, line) && line != "t\td\tts\thormone") {}
+
+    while (std::getline(in, line) && !line.empty())
+    {
+        std::istringstream row(line);
+
+        if (!(row >> t >> d >> ts >> level) || t < 0 || t >= h.maxT || ts < 0 || ts >= h.maxTs || d < 0 || d > h.maxD) return false;
+
+        levels[(size_t(t)*h.maxTs + ts)*(h.maxD+1) + d] = level;
+        ++rows;
+    }
+
+    while (std::getline(in, line))
+    {
+        std::istringstream field(line);
+
+        if (field >> name && name == "nIterations") field >> iterations;
+    }
+
+    return rows == levels.size();
+} // end ReadRows()
+
+
+/* CHECK A STORE OF ONE POINT AGAINST THE ROWS */
+void CheckStore(const char *path, bool packed, const sd_pack_header &h, const std::vector<int32_t> &levels, int iterations)
+{
+    sd_store s;
+    long k;
+    int t,ts,d;
+    bool same;
+    std::vector<int32_t> unpacked(levels.size());
+    std::string kind = packed ? "packed store " : "plain store ";
+
+    if (sd_store_open(&s, path) != 0)
+    {
+        Expect(false, kind + path + " opens");
+        return;
+    }
+
+    Expect(sd_store_count(&s) == 1 && sd_store_packed(&s) == packed, kind + "holds the point, of its kind");
+    Expect(s.header->maxT == h.maxT && s.header->maxTs == h.maxTs && s.header->maxD == h.maxD && s.header->maxH == h.maxH, kind + "has the grid of the point");
+
+    k = sd_store_find(&s, s.index[0].params);
+
+    Expect(k == 0 && s.index[0].iterations == iterations && s.index[0].converged, kind + "index gives the iterations of stressL*.txt");
+    Expect(sd_store_unpack(&s, 0, &unpacked[0]) == 0 && unpacked == levels, kind + "sd_store_unpack() gives the rows of stressL*.txt");
+
+    if (!packed)
+    {
+        same = true;
+
+        for (t=0;t<h.maxT;++t)
+        {
+            for (ts=0;ts<h.maxTs;++ts)
+            {
+                for (d=0;d<=h.maxD;++d)
+                {
+                    same = same && sd_store_hormone(&s, 0, t, ts, d) == levels[(size_t(t)*h.maxTs + ts)*(h.maxD+1) + d];
+                }
+            }
+        }
+
+        Expect(same, kind + "sd_store_hormone() gives the rows of stressL*.txt");
+    }
+
+    sd_store_close(&s);
+} // end CheckStore()
+
+
+/* MAIN PROGRAM */
+int main(int argc, char** argv)
+{
+    int iterations;
+    long nlines;
+    sd_pack_header h;
+    int32_t *fromFile;
+    std::vector<int32_t> levels,unpacked;
+    std::vector<unsigned char> bytes;
+
+    // levels and deltas at the ends of the range, which the solver never gives
+    const int32_t edge[] = {0, -1, 1, INT32_MAX, INT32_MIN, INT32_MIN, 7, 7, 7, -300, 300, 0};
+    std::vector<int32_t> back(sizeof(edge)/sizeof(edge[0]));
+
+    if (argc != 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " stressL*.txt stratL*.sdp PLAIN.sds PACKED.sds" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bytes.resize(sd_pack_bound(2, back.size()/2));
+    bytes.resize(sd_pack(edge, 2, back.size()/2, &bytes[0]));
+    Expect(sd_unpack(&bytes[0], bytes.size(), 2, back.size()/2, &back[0]) == (long)bytes.size() && std::equal(back.begin(), back.end(), edge), "codec round trip at the ends of the int32 range");
+
+    if (sd_pack_load(argv[2], &h, &fromFile) != 0)
+    {
+        Expect(false, std::string("packed strategy ") + argv[2] + " loads");
+        return EXIT_FAILURE;
+    }
+
+    nlines = long(h.maxTs)*(h.maxD+1);
+
+    if (!ReadRows(argv[1], h, levels, iterations))
+    {
+        Expect(false, std::string("every row of ") + argv[1] + " is there, for the grid of " + argv[2]);
+        free(fromFile);
+        return EXIT_FAILURE;
+    }
+
+    Expect(std::equal(levels.begin(), levels.end(), fromFile), "stratL*.sdp gives the rows of stressL*.txt");
+    free(fromFile);
+
+    // and in memory, as the store packs them
+    bytes.resize(sd_pack_bound(nlines, h.maxT));
+    bytes.resize(sd_pack(&levels[0], nlines, h.maxT, &bytes[0]));
+    unpacked.resize(levels.size());
+    Expect(bytes.size() == h.bytes && sd_unpack(&bytes[0], bytes.size(), nlines, h.maxT, &unpacked[0]) == (long)bytes.size() && unpacked == levels,
+        "sd_pack() of the rows gives as many bytes as stratL*.sdp, and sd_unpack() the rows again");
+
+    CheckStore(argv[3], false, h, levels, iterations);
+    CheckStore(argv[4], true, h, levels, iterations);
+
+    std::cout << (nFailed == 0 ? "all checks passed" : "some checks FAILED") << std::endl;
+
+  return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
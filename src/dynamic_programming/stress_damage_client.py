@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Client of stress_damage_server.exe, the local solve server.
+
+    import stress_damage_client
+    c = stress_damage_client.Client("stress_damage.sock")
+    r = c.solve(0.095, 0.005, Kmort=0.01)   # {'id': 1, 'converged': 1, 'iterations': 461, ...}
+    c.forward(r["id"])
+    c.array(r["id"], "hormone")[50, 0, :]   # NumPy array in shared memory handed over by the server
+
+Arrays are read-only views of a copy the server makes into shared memory and
+passes along with the reply, so they stay valid after the model has been
+evicted from its cache.
+"""
+
+import mmap
+import os
+import socket
+
+import numpy as np
+
+
+class ServerError(RuntimeError):
+    pass
+
+
+class Client:
+    """Connection to a solve server on the Unix domain socket `path`."""
+
+    def __init__(self, path="stress_damage.sock"):
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.connect(path)
+        self._buffer = b""
+
+    def close(self):
+        if self._sock is not None:
+            self._sock.close()
+            self._sock = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def request(self, line):
+        """Send one request line; returns the fields of the reply and any descriptors passed with it."""
+        self._sock.sendall(line.encode() + b"\n")
+
+        fds = []
+
+        while b"\n" not in self._buffer:
+            data, received, _, _ = socket.recv_fds(self._sock, 65536, 4)
+
+            if not data:
+                raise ServerError("the server has closed the connection")
+
+            self._buffer += data
+            fds += received
+
+        reply, self._buffer = self._buffer.split(b"\n", 1)
+        status, _, rest = reply.decode().partition(" ")
+
+        if status != "ok":
+            for fd in fds:
+                os.close(fd)
+            raise ServerError(rest)
+
+        fields = {}
+
+        for field in rest.split():
+            name, _, value = field.partition("=")
+            try:
+                fields[name] = int(value)
+            except ValueError:
+                try:
+                    fields[name] = float(value)
+                except ValueError:
+                    fields[name] = value
+
+        return fields, fds
+
+    def solve(self, pLeave, pArrive, pAttack=0.5, alpha=1.0, Kmort=0.0, Kfec=0.05):
+        """Solve a parameter point, warm-started from the nearest one the server holds."""
+        return self.request("solve %r %r %r %r %r %r" % (pLeave, pArrive, pAttack, alpha, Kmort, Kfec))[0]
+
+    def forward(self, id):
+        """Forward calculation of model `id`; returns predDeaths and damageDeaths."""
+        return self.request("forward %d" % id)[0]
+
+    def simulate(self, id, seed=0):
+        """Simulate one individual under model `id`; returns the rows."""
+        self.request("simulate %d %d" % (id, seed))
+        return self.array(id, "sim")
+
+    def compare(self, a, b, n=10000, seed=0):
+        """Paired simulation of n lives under each of models `a` and `b` on common
+        random numbers; returns the reproductive output ("repro") and lifespan
+        ("lifespan") comparisons, each a dict of meanA, meanB, diff (a - b), se,
+        lo, hi (95% interval) and seUnpaired."""
+        fields = self.request("compare %d %d %d %d" % (a, b, n, seed))[0]
+
+        names = ("meanA", "meanB", "diff", "se", "lo", "hi", "seUnpaired")
+
+        return {outcome: dict(zip(names, (float(x) for x in fields[outcome].split(","))))
+                for outcome in ("repro", "lifespan")}
+
+    def array(self, id, name):
+        """Array `name` (hormone, W, F or sim) of model `id`."""
+        fields, fds = self.request("get %d %s" % (id, name))
+
+        shape = tuple(int(n) for n in str(fields["shape"]).split(","))
+        dtype = np.dtype(fields["dtype"])
+
+        # the array holds on to the mapping, which outlives the descriptor
+        shared = mmap.mmap(fds[0], 0, prot=mmap.PROT_READ)
+        os.close(fds[0])
+
+        return np.frombuffer(shared, dtype=dtype).reshape(shape)
+
+    def drop(self, id):
+        self.request("drop %d" % id)
+
+    def stats(self):
+        return self.request("stats")[0]
+
+    def shutdown(self):
+        self.request("shutdown")
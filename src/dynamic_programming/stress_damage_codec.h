@@ -0,0 +1,218 @@
+/* **********************************************************************************
+ * Packed strategies: a compact encoding of hormone[t][ts][d], used by
+ * stress_damage_lh.exe --pack for the stratL*.sdp files and for the records
+ * of a packed strategy store (see stress_damage_store.h).
+ *
+ * The optimal hormone level is piecewise constant in t once pPred has levelled
+ * off, so each line (ts,d) is encoded along t:
+ *
+ *   zigzag varint   hormone at t = 0
+ *   then pairs of   zigzag varint delta, varint n: the next n steps along t
+ *                   each change the level by delta
+ *
+ * until all maxT values of the line are covered. The lines follow each other
+ * in the order ts, then d. Varints hold 7 bits a byte, low bits first, the top
+ * bit set on all but the last byte; zigzag maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+ *
+ * A stratL*.sdp file is an sd_pack_header followed by its bytes of encoding.
+ *
+ * Header only, C or C++:
+ *
+ *   sd_pack_header h;
+ *   int32_t *hormone;
+ *   if (sd_pack_load("stratL0.095000A0.005000Kmort0.010000Kfec0.050000.sdp", &h, &hormone) == 0)
+ *   {
+ *       int level = hormone[((size_t)t * h.maxTs + ts) * (h.maxD + 1) + d];
+ *       free(hormone);
+ *   }
+ * ********************************************************************************** */
+
+#ifndef STRESS_DAMAGE_CODEC_H
+#define STRESS_DAMAGE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SD_PACK_MAGIC "SDPACK"
+#define SD_PACK_VERSION 1
+
+typedef struct sd_pack_header
+{
+    char magic[8];          /* SD_PACK_MAGIC */
+    uint32_t version;       /* SD_PACK_VERSION */
+    int32_t maxT;           /* extents of hormone[t][ts][d] */
+    int32_t maxTs;
+    int32_t maxD;           /* d = 0, ..., maxD */
+    int32_t maxH;
+    uint32_t reserved;
+    uint64_t bytes;         /* of encoding that follow */
+} sd_pack_header;
+
+
+static inline unsigned char *sd_put_varint(unsigned char *p, uint32_t x)
+{
+    while (x >= 0x80)
+    {
+        *p++ = (unsigned char)(x | 0x80);
+        x >>= 7;
+    }
+
+    *p++ = (unsigned char)x;
+
+    return p;
+}
+
+
+/* returns the byte after the varint, or NULL if it runs past end */
+static inline const unsigned char *sd_get_varint(const unsigned char *p, const unsigned char *end, uint32_t *x)
+{
+    int shift;
+
+    *x = 0;
+
+    for (shift = 0; p < end && shift < 32; shift += 7)
+    {
+        *x |= (uint32_t)(*p & 0x7f) << shift;
+
+        if ((*p++ & 0x80) == 0) return p;
+    }
+
+    return NULL;
+}
+
+
+static inline uint32_t sd_zigzag(int32_t x)
+{
+    return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+
+static inline int32_t sd_unzigzag(uint32_t x)
+{
+    return (int32_t)(x >> 1) ^ -(int32_t)(x & 1);
+}
+
+
+/* most bytes that sd_pack() can take for nlines lines of len values */
+static inline size_t sd_pack_bound(long nlines, long len)
+{
+    return (size_t)nlines * (5 + 10 * (size_t)(len > 1 ? len - 1 : 0));
+}
+
+
+/* packs v[t*nlines + line], t = 0, ..., len-1, into out; returns the bytes taken */
+static inline size_t sd_pack(const int32_t *v, long nlines, long len, unsigned char *out)
+{
+    unsigned char *p;
+    long line,t,n;
+    uint32_t delta;
+
+    p = out;
+
+    for (line = 0; line < nlines; ++line)
+    {
+        p = sd_put_varint(p, sd_zigzag(v[line]));
+
+        for (t = 1; t < len; t += n)
+        {
+            // differences taken modulo 2^32, so that they cannot overflow
+            delta = (uint32_t)v[t*nlines + line] - (uint32_t)v[(t-1)*nlines + line];
+
+            for (n = 1; t + n < len && (uint32_t)v[(t+n)*nlines + line] - (uint32_t)v[(t+n-1)*nlines + line] == delta; ++n) {}
+
+            p = sd_put_varint(p, sd_zigzag((int32_t)delta));
+            p = sd_put_varint(p, (uint32_t)n);
+        }
+    }
+
+    return (size_t)(p - out);
+}
+
+
+/* unpacks the n bytes at in into v[t*nlines + line]; returns the bytes used, or -1 if they are not such an encoding */
+static inline long sd_unpack(const unsigned char *in, size_t n, long nlines, long len, int32_t *v)
+{
+    const unsigned char *p,*end;
+    long line,t,k;
+    uint32_t x,run,level;
+    int32_t delta;
+
+    p = in;
+    end = in + n;
+
+    for (line = 0; line < nlines; ++line)
+    {
+        if ((p = sd_get_varint(p, end, &x)) == NULL) return -1;
+
+        level = (uint32_t)sd_unzigzag(x);
+        v[line] = (int32_t)level;
+
+        for (t = 1; t < len; t += run)
+        {
+            if ((p = sd_get_varint(p, end, &x)) == NULL || (p = sd_get_varint(p, end, &run)) == NULL
+                    || run == 0 || run > (uint32_t)(len - t))
+            {
+                return -1;
+            }
+
+            delta = sd_unzigzag(x);
+
+            for (k = 0; k < (long)run; ++k)
+            {
+                level += (uint32_t)delta;
+                v[(t+k)*nlines + line] = (int32_t)level;
+            }
+        }
+    }
+
+    return (long)(p - in);
+}
+
+
+/* reads the stratL*.sdp file at path; *values is then hormone[t][ts][d], to be freed by the caller.
+   returns 0, or -1 if it cannot be read or is not a packed strategy */
+static inline int sd_pack_load(const char *path, sd_pack_header *h, int32_t **values)
+{
+    FILE *f;
+    unsigned char *bytes;
+    size_t nvalues;
+    long nlines;
+    int ok;
+
+    *values = NULL;
+
+    if ((f = fopen(path, "rb")) == NULL) return -1;
+
+    if (fread(h, sizeof(*h), 1, f) != 1 || memcmp(h->magic, SD_PACK_MAGIC, sizeof(SD_PACK_MAGIC)) != 0
+            || h->version != SD_PACK_VERSION || h->maxT <= 0 || h->maxTs <= 0 || h->maxD < 0)
+    {
+        fclose(f);
+        return -1;
+    }
+
+    nlines = (long)h->maxTs * (h->maxD + 1);
+    nvalues = (size_t)h->maxT * nlines;
+
+    bytes = (unsigned char *)malloc(h->bytes > 0 ? h->bytes : 1);
+    *values = (int32_t *)malloc(nvalues * sizeof(int32_t));
+
+    ok = bytes != NULL && *values != NULL && fread(bytes, 1, h->bytes, f) == h->bytes
+        && sd_unpack(bytes, h->bytes, nlines, h->maxT, *values) == (long)h->bytes;
+
+    fclose(f);
+    free(bytes);
+
+    if (!ok)
+    {
+        free(*values);
+        *values = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif /* STRESS_DAMAGE_CODEC_H */
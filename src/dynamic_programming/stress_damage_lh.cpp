@@ -9,638 +9,1008 @@
 
 //HEADER FILES
 
-#include <cstdlib>
-#include <stdio.h>
-#include <ctime>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
-#include <fstream>
-#include <cmath>
-#include <random>
-#include <vector>
-#include <algorithm>
-#include <chrono>
-#include <string>
-#include <cassert>
-
-// constants, type definitions, etc.
-const int seed        = std::time(0); // pseudo-random seed
-
-double pLeave;   // probability that predator leaves
-double pArrive;  // probability that predator arrives
-double pAttack  = 0.5;     // probability that predator attacks if present
-double alpha    = 1.0;     // parameter controlling effect of hormone level on pKilled
-//const double beta     = 1.5;     // parameter controlling effect of hormone level on reproductive rate
-const double mu0      = 0.002;   // background mortality (independent of hormone level and predation risk)
-const double phi_inv  = 1.0/((sqrt(5.0)+1.0)/2.0); // inverse of golden ratio (for golden section search)
-const int maxD        = 20;      // maximum damage level
-double Kmort        = 0.0;    // parameter Kmort controlling increase in mortality with damage level
-double Kfec        = 0.05;    // parameter Kmort controlling increase in mortality with damage level
-const int maxI        = 1000000; // maximum number of iterations
-const int maxT        = 100;     // maximum number of time steps since last saw predator
-const int maxH        = 500;     // maximum hormone level
-const int skip        = 1;      // interval between print-outs
-const int maxTs = 10; // duration of a season
-
-std::ofstream outputfile;  // output file
-std::ofstream fwdCalcfile; // forward calculation output file
-std::ofstream attsimfile;  // simulated attacks output file
-std::stringstream outfile; // for naming output file
-
-// random numbers
-std::mt19937 mt(seed); // random number generator
-std::uniform_real_distribution<double> Uniform(0, 1); // real number between 0 and 1 (uniform)
-
-///int hormone[maxT][maxTs][maxD+1];        // hormone level (strategy)
-std::vector < std::vector < std::vector<int> > > 
-    hormone(maxT, std::vector < std::vector <int> >(maxTs, std::vector<int>(maxD + 1, 0)));
-
-double pKilled[maxH];             // probability of being killed by an attacking predator
-double mu[maxD+1];                // probability of background mortality, as a function of damage
-double dnew[maxD+1][maxH];        // new damage level, as a function of previous damage and hormone
-double repro[maxTs][maxD+1];       // reproductive output
-//double Wopt[maxT][maxTs][maxD+1];        // fitness immediately after predator has/hasn't attacked, under optimal decision h
-//double W[maxT][maxTs][maxD+1][maxH];     // expected fitness at start of time step, before predator does/doesn't attack
-//double Wnext[maxT][maxTs][maxD+1][maxH]; // expected fitness at start of next time step
-//
-//double F[maxT][maxTs][maxD+1][maxH];     // frequency of individuals at start of time step, before predator does/doesn't attack
-//double Fnext[maxT][maxTs][maxD+1][maxH]; // frequency of individuals at start of next time step
+#include "stress_damage_lh.hpp"
+#include "stress_damage_store.h"
+#include "stress_damage_codec.h"
+#include <sys/stat.h>
+#include <sys/file.h>
+
+std::string jobFile;  // --jobs=FILE: solve every parameter tuple in FILE, one per line, in this one process
+std::string queueDir; // --queue=DIR: work queue in DIR/pending, claimed, done and failed, shared by any number of processes
+int staleAfter = 600; // --stale=SECONDS: a claim not touched for this long is taken to belong to a crashed worker
+int procs = 1;        // --procs=K: number of processes, started separately, that share each solve
+int rank = -1;        // --rank=R: index of this process among them
+std::string shmName;  // --shm=NAME: shared memory object through which they share it
+std::string storeFile; // --store=FILE: append the strategy of every point to this strategy store
+const uint64_t storeCapacity = 1 << 16; // points the index of a new store has room for
+bool footprint = false; // --footprint: print the bytes the solver arrays of a point take, and exit
 
-// Wopt
-std::vector < std::vector < std::vector<double> > > 
-    Wopt(maxT, std::vector < std::vector <double> >(maxTs, std::vector<double>(maxD+1, 0.0)));
 
-// W
-std::vector < std::vector < std::vector < std::vector <double> > > > 
-    W(maxT, std::vector < std::vector < std::vector <double> > >(maxTs, std::vector < std::vector <double> >(maxD+1, std::vector<double>(maxH, 0.0))));
+void init_params(int argc, char** argv)
+{
+    int k;
+    char *end;
+    double p[6];
 
-// reproductive value V    
-std::vector < std::vector < std::vector<double> > > 
-    V(maxT, std::vector < std::vector <double> >(maxD+1, std::vector<double>(maxH, 0.0)));
+    // whether the values make sense is up to CheckParams(); here they only need to be numbers
+    for (k=0;k<6;++k)
+    {
+        p[k] = strtod(argv[k+1], &end);
 
-// Wnext
-std::vector < std::vector < std::vector < std::vector <double> > > > 
-    Wnext(maxT, std::vector < std::vector < std::vector <double> > >(maxTs, std::vector < std::vector <double> >(maxD+1, std::vector<double>(maxH, 0.0))));
+        if (end == argv[k+1] || *end != '\0')
+        {
+            std::cerr << "Parameter " << k+1 << " is not a number: " << argv[k+1] << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pLeave = p[0];
+    pArrive = p[1];
+    pAttack = p[2];
+    alpha = p[3];
+    Kmort = p[4];
+    Kfec = p[5];
+} // end init_params() 
+
+/* READ OPTIONAL SETTINGS OF THE FORM --name=value, FROM argv[first] ON */
+void init_options(int argc, char** argv, int first)
+{
+    int arg;
+    size_t eq;
+    std::string opt,name,value,orderT,orderD;
+
+    orderT = "ascending";
+    orderD = "ascending";
+
+    for (arg = first; arg < argc; ++arg)
+    {
+        opt = argv[arg];
+        eq = opt.find('=');
+        name = opt.substr(0, eq);
+        value = eq == std::string::npos ? "" : opt.substr(eq + 1);
+
+        if (name == "--precision" && (value == "double" || value == "mixed"))
+        {
+            precision = value; // mixed: single precision, then polished in double precision
+        }
+        else if (name == "--update" && (value == "jacobi" || value == "gauss-seidel"))
+        {
+            inPlace = value == "gauss-seidel";
+        }
+        else if ((name == "--order-t" || name == "--order-d") && (value == "ascending" || value == "descending" || value == "red-black"))
+        {
+            if (name == "--order-t") orderT = value; else orderD = value;
+        }
+        else if (name == "--layout" && (value == "natural" || value == "blocked"))
+        {
+            blocked = value == "blocked";
+        }
+        else if (name == "--tile-t" && atoi(value.c_str()) > 0)
+        {
+            tileT = atoi(value.c_str());
+        }
+        else if (name == "--fwdcalc" && (value.empty() || value == "full"))
+        {
+            runFwdCalc = true;
+            fwdDump = value == "full"; // marginals only, unless every frequency is wanted
+        }
+        else if (name == "--threads" && atoi(value.c_str()) > 0)
+        {
+            nThreads = atoi(value.c_str());
+        }
+        else if (name == "--stop" && (value == "residual" || value == "policy"))
+        {
+            stopRule = value;
+        }
+        else if (name == "--stable" && atoi(value.c_str()) > 0)
+        {
+            stableIters = atoi(value.c_str());
+        }
+        else if (name == "--search" && (value == "golden" || value == "pruned" || value == "exhaustive"))
+        {
+            search = value; // pruned: skip the hormone levels HormoneFloor() rules out; exhaustive: the exact argmax
+        }
+        else if (name == "--footprint" && value.empty())
+        {
+            footprint = true;
+        }
+        else if (name == "--pack" && value.empty())
+        {
+            packStrat = true;
+        }
+        else if (name == "--lives" && atol(value.c_str()) > 0)
+        {
+            nLives = atol(value.c_str());
+        }
+        else if (name == "--horizon" && atoi(value.c_str()) > 0)
+        {
+            horizon = atoi(value.c_str());
+        }
+        else if (name == "--sim" && (value == "step" || value == "event" || value == "batch"))
+        {
+            simEngine = value;
+        }
+        else if (name == "--pin" && value.empty())
+        {
+            pin = true;
+        }
+        else if (name == "--node" && !value.empty() && atoi(value.c_str()) >= 0)
+        {
+            node = atoi(value.c_str());
+        }
+        else if (name == "--maxT" && atoi(value.c_str()) > 1)
+        {
+            maxT = atoi(value.c_str());
+        }
+        else if (name == "--maxTs" && atoi(value.c_str()) > 0)
+        {
+            maxTs = atoi(value.c_str());
+        }
+        else if (name == "--maxD" && atoi(value.c_str()) > 0)
+        {
+            maxD = atoi(value.c_str());
+        }
+        else if (name == "--maxH" && atoi(value.c_str()) > 0)
+        {
+            maxH = atoi(value.c_str());
+        }
+        else if (name == "--scratch" && !value.empty())
+        {
+            scratch = value;
+        }
+        else if (name == "--jobs" && !value.empty())
+        {
+            jobFile = value;
+        }
+        else if (name == "--queue" && !value.empty())
+        {
+            queueDir = value;
+        }
+        else if (name == "--stale" && atoi(value.c_str()) > 0)
+        {
+            staleAfter = atoi(value.c_str());
+        }
+        else if (name == "--procs" && atoi(value.c_str()) > 0)
+        {
+            procs = atoi(value.c_str());
+        }
+        else if (name == "--rank" && !value.empty() && atoi(value.c_str()) >= 0)
+        {
+            rank = atoi(value.c_str());
+        }
+        else if (name == "--shm" && !value.empty())
+        {
+            shmName = value[0] == '/' ? value : "/" + value;
+        }
+        else if (name == "--store" && !value.empty())
+        {
+            storeFile = value;
+        }
+        else if (name == "--rss-budget" && atof(value.c_str()) > 0)
+        {
+            rssBudget = size_t(atof(value.c_str()) * (1 << 20));
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << opt << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
 
-// F
-std::vector < std::vector < std::vector < std::vector <double> > > > 
-    F(maxT, std::vector < std::vector < std::vector <double> > >(maxTs, std::vector < std::vector <double> >(maxD+1, std::vector<double>(maxH, 0.0))));
+    if (rssBudget > 0 && scratch.empty())
+    {
+        std::cerr << "--rss-budget needs --scratch, as only file-backed arrays can be let go of" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-// Fnext
-std::vector < std::vector < std::vector < std::vector <double> > > > 
-    Fnext(maxT, std::vector < std::vector < std::vector <double> > >(maxTs, std::vector < std::vector <double> >(maxD+1, std::vector<double>(maxH, 0.0))));
+    if (procs > 1 && (rank < 0 || rank >= procs || shmName.empty() || procs > std::min(maxProcs, maxT - 1)))
+    {
+        std::cerr << "--procs=K needs --rank=R, 0 <= R < K, and --shm=NAME, the same for all K processes, and at most " << std::min(maxProcs, maxT - 1) << " of them" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
+    if (horizon > 0 && (procs > 1 || runFwdCalc || nLives > 0 || packStrat || !storeFile.empty()))
+    {
+        std::cerr << "--horizon writes an age-dependent strategy of its own, so not with --procs, --fwdcalc, --lives, --pack or --store" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-    
-    double pPred[maxT];               // probability that predator is present
-double totfitdiff;                // fitness difference between optimal strategy in successive iterations
+    if (procs > 1 && (nThreads > 1 || !scratch.empty() || !queueDir.empty()))
+    {
+        std::cerr << "--procs runs one thread per process on a shared memory arena, so not with --threads, --scratch or --queue" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-int i;     // iteration
+    if (!storeFile.empty() && !packStrat && maxH > INT16_MAX)
+    {
+        std::cerr << "--store keeps hormone levels as 16 bit integers unless --pack is given, so maxH can be at most " << INT16_MAX << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
+    // once the grid is known
+    tOrder = SweepOrder(orderT, 1, maxT);
+    dOrder = SweepOrder(orderD, 0, maxD + 1);
+    tRedBlack = orderT == "red-black";
+} // end init_options()
 
-/* SPECIFY FINAL FITNESS */
-void FinalFit()
+/* RESTRICT THE PROCESS TO ONE NODE AND PIN THE THREADS IF ASKED, AND START THE TEAM */
+void init_threads()
 {
-  int t,d,h;
+    int k;
+    std::vector<int> cpus;
+    std::vector<std::vector<int> > nodes;
 
-    for (t=1;t<maxT;++t) // note that Wnext is undefined for t=0 because t=1 if predator has just attacked
+    nodes = Nodes();
+
+    // threads started afterwards inherit the restriction, and memory they first
+    // touch comes from the node they run on, so nothing else needs binding
+    if (node >= 0)
     {
-        for (d=0;d<=maxD;++d)
+        if (node >= (int)nodes.size() || nodes[node].empty())
         {
-            for (h=0;h<maxH;++h)
-            {
-               V[t][d][h] =  Wnext[t][maxTs - 1][d][h] = repro[maxTs - 1][d];
-            }
+            std::cerr << "No CPUs available on node " << node << std::endl;
+            exit(EXIT_FAILURE);
         }
-    }
-} // end FinalFit()
 
+        SetAffinity(nodes[node]);
+        nodes = std::vector<std::vector<int> >(1, nodes[node]);
+    }
 
-/* CALCULATE PROBABILITY THAT PREDATOR IS PRESENT */
-void PredProb()
-{
-  int t;
+    // consecutive threads own consecutive t blocks, so fill one node before the next
+    if (pin)
+    {
+        for (k=0;k<(int)nodes.size();++k) cpus.insert(cpus.end(), nodes[k].begin(), nodes[k].end());
+    }
 
-  pPred[1] = 1.0 - pLeave; // if predator attacked in last time step
+    // a process of a group takes the CPU a thread of that number would have
+    if (procs > 1 && !cpus.empty())
+    {
+        cpus = std::vector<int>(1, cpus[rank % cpus.size()]);
+    }
 
-  for (t=2;t<maxT;++t) // if predator did NOT attack in last time step
-  {
-//      Pr(predator present at time t | predator did not attack at time t-1)
-//      = Pr (predator did not attack at time t-1 | predator present at time t) * 
-//              Pr( predator present at time t)  / Pr(predator did not attack at time t-1)
-    pPred[t] = (pPred[t-1]*(1.0-pAttack)*(1.0-pLeave)+(1.0-pPred[t-1])*pArrive) / (1.0 - pPred[t-1]*pAttack);
-  }
-} // end PredProb
+    TeamStart(nThreads, cpus);
 
+    if (procs > 1)
+    {
+        GroupJoin(shmName, procs, rank, Footprint());
+    }
 
+    if (team.n > 1 || pin || node >= 0)
+    {
+        std::cout << (procs > 1 ? "processes: " : "threads: ") << team.n << (pin ? ", pinned" : "");
+        if (node >= 0) std::cout << ", on node " << node;
+        std::cout << std::endl;
+    }
+} // end init_threads()
 
-/* CALCULATE PROBABILITY OF BEING KILLED BY AN ATTACKING PREDATOR */
-void Predation()
+/* MAP THE ARENA, ONCE FOR ALL PARAMETER POINTS AS THEY ALL HAVE THE SAME GRID */
+void init_arena()
 {
-  int h;
+    // everything comes out of one region; the fitness arrays are
+    // handed back to it before the forward calculation
+    if (!ArenaReserve(Footprint()))
+    {
+        std::cerr << arenaError << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "solver arrays: " << arena.capacity / (1 << 20) << " MB" << (arena.hugetlb ? " of huge pages" : "");
+    if (arena.fd >= 0) std::cout << " in a scratch file in " << scratch << ", " << Window<double>(1, 2) << " of " << maxTs << " slices mapped at once";
+    std::cout << std::endl;
+} // end init_arena()
 
-  for (h=0;h<maxH;++h)
-  {
-    pKilled[h] = 1.0 - pow(double(h)/double(maxH),alpha);
-  }
-} // end Predation()
 
 
-/* CALCULATE BACKGROUND MORTALITY */
-void Mortality()
+/* PRINT WHAT THE ARENA WILL TAKE, FOR SCHEDULERS THAT ADMIT JOBS BY MEMORY; it depends
+   on the grid and the phases switched on, but not on the parameters */
+int PrintFootprint()
 {
-  int d;
+    // with --procs the processes share one arena, and it has no edge rows
+    team.n = procs > 1 ? 1 : nThreads;
 
-  for (d=0;d<=maxD;++d)
-  {
-    mu[d] = std::min(1.0,mu0 + Kmort*double(d));
-  }
-} // end Mortality()
+    std::cout << "footprint" << "\t" << RoundUp(Footprint(), hugePage) << std::endl;
 
+    return EXIT_SUCCESS;
+} // end PrintFootprint()
 
 
-/* CALCULATE DAMAGE */
-void Damage()
+/* PEAK RESIDENT MEMORY OF THE PROCESS SINCE IT STARTED OR SINCE ResetPeakRSS(), IN BYTES; 0 if unknown */
+size_t PeakRSS()
 {
-  int d,h;
+    std::string line;
+    std::ifstream status("/proc/self/status");
 
-  for (d=0;d<=maxD;++d)
-  {
-    for (h=0;h<maxH;++h)
+    while (std::getline(status, line))
     {
-      dnew[d][h] = std::max(0.0,std::min(double(maxD),double(d) + 4.0*(double(h)/double(maxH))*(double(h)/double(maxH))-1.0));
+        if (line.compare(0, 6, "VmHWM:") == 0) return size_t(atol(line.c_str() + 6)) << 10;
     }
-  }
-} // void Damage()
 
+    return 0;
+} // end PeakRSS()
 
-/* CALCULATE PROBABILITY OF REPRODUCING */
-void Reproduction()
+
+/* START MEASURING PEAK RESIDENT MEMORY AFRESH, SO THAT EACH JOB GETS ITS OWN */
+void ResetPeakRSS()
 {
-  int d, ts;
+    std::ofstream clear("/proc/self/clear_refs");
 
-  for (ts = 0; ts < maxTs; ++ts)
-  { 
-    for (d=0;d<=maxD;++d)
-    {
-        repro[ts][d] = ts == maxTs - 1 ? std::max(0.0, 1.0 - Kfec*double(d)) : 0.0;
+    clear << "5" << std::endl; // resets VmHWM to the current RSS; fails harmlessly on kernels without it
+} // end ResetPeakRSS()
+
+
+
+/* PACK THE STRATEGY OF THE CURRENT POINT (see stress_damage_codec.h) */
+std::vector<unsigned char> PackStrategy()
+{
+    int t,ts,d;
+    long nlines;
+    std::vector<int32_t> levels;
+    std::vector<unsigned char> bytes;
+
+    nlines = long(maxTs)*(maxD+1);
+    levels.resize(size_t(maxT)*nlines);
 
-        if (maxTs - 1)
+    for (t=0;t<maxT;++t)
+    {
+        for (ts=0;ts<maxTs;++ts)
         {
-            std::cout << repro[ts][d] << std::endl;
+            for (d=0;d<=maxD;++d)
+            {
+                levels[(size_t(t)*maxTs + ts)*(maxD+1) + d] = hormone[t][ts][d];
+            }
         }
     }
-  }
-} // end Reproduction()
+
+    bytes.resize(sd_pack_bound(nlines, maxT));
+    bytes.resize(sd_pack(&levels[0], nlines, maxT, &bytes[0]));
+
+    return bytes;
+} // end PackStrategy()
+
+
+/* WRITE THE STRATEGY OF THE CURRENT POINT PACKED, FOR --pack */
+void PrintPacked()
+{
+    sd_pack_header header;
+    std::vector<unsigned char> bytes;
+
+    ///////////////////////////////////////////////////////
+    outfile.str("");
+    outfile << "stratL";
+    outfile << std::fixed << pLeave;
+    outfile << "A";
+    outfile << std::fixed << pArrive;
+    outfile << "Kmort";
+    outfile << std::fixed << Kmort;
+    outfile << "Kfec";
+    outfile << std::fixed << Kfec;
+    outfile << ".sdp";
+    std::string stratfilename = outfile.str();
+    std::ofstream stratfile(stratfilename.c_str(), std::ios::binary);
+    ///////////////////////////////////////////////////////
+
+    bytes = PackStrategy();
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SD_PACK_MAGIC, sizeof(SD_PACK_MAGIC));
+    header.version = SD_PACK_VERSION;
+    header.maxT = maxT;
+    header.maxTs = maxTs;
+    header.maxD = maxD;
+    header.maxH = maxH;
+    header.bytes = bytes.size();
+
+    stratfile.write((const char *)&header, sizeof(header));
+    stratfile.write((const char *)&bytes[0], bytes.size());
+    stratfile.close();
+} // end PrintPacked()
+
+
+/* WHETHER A STORE WITH THIS HEADER CAN TAKE STRATEGIES OF THE CURRENT GRID */
+bool StoreFits(const sd_store_header &header)
+{
+    return memcmp(header.magic, SD_STORE_MAGIC, sizeof(SD_STORE_MAGIC)) == 0
+        && header.version == (header.flags & SD_STORE_PACKED ? SD_STORE_VERSION_PACKED : SD_STORE_VERSION)
+        && header.maxT == maxT && header.maxTs == maxTs && header.maxD == maxD && header.maxH == maxH
+        && (header.flags & SD_STORE_PACKED || maxH <= INT16_MAX);
+} // end StoreFits()
 
 
+/* CHECK BEFORE ANY SOLVING THAT AN EXISTING STORE CAN TAKE THE STRATEGIES */
+void init_store()
+{
+    sd_store_header header;
+    std::ifstream in(storeFile.c_str(), std::ios::binary);
+
+    if (in && in.peek() != EOF && !(in.read((char *)&header, sizeof(header)) && StoreFits(header)))
+    {
+        std::cerr << "Strategy store " << storeFile << " is not a store of this version and grid" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+} // end init_store()
+
 
-/* CALCULATE OPTIMAL DECISION FOR EACH t */
-void OptDec()
+/* APPEND THE STRATEGY OF THE CURRENT POINT TO THE STRATEGY STORE (see stress_damage_store.h);
+   a new store is packed with --pack, and an existing one keeps its kind */
+void StoreAppend(bool converged)
 {
-    int t,ts,h,d,d1,d2,LHS,RHS,x1,x2,cal_x1,cal_x2;
-    double fitness,fitness_x1,fitness_x2,ddec;
+    int fd,t,ts,d;
+    uint64_t k;
+    struct stat info;
+    sd_store_header header;
+    sd_store_entry entry;
+    std::vector<int16_t> levels;
+    std::vector<unsigned char> bytes;
+
+    fd = open(storeFile.c_str(), O_RDWR | O_CREAT, 0644);
+
+    // any number of processes may append to the same store
+    if (fd < 0 || flock(fd, LOCK_EX) != 0 || fstat(fd, &info) != 0)
+    {
+        std::cerr << "Cannot open strategy store " << storeFile << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&header, 0, sizeof(header));
 
-    // go from maxTs down to 0
-    // start from maxTs - 2, as we need to reach back
-    // to array positions given by ts + 1
-    for (ts = maxTs - 1; ts >= 0; --ts)
+    if (info.st_size == 0)
     {
-      // calculate optimal decision h given current t, ts and d (N.B. t=0 if survived attack)
-      // where h in t, ts, and d is unimodal
+        // the index is a hole in the file until it is written
+        memcpy(header.magic, SD_STORE_MAGIC, sizeof(SD_STORE_MAGIC));
+        header.version = packStrat ? SD_STORE_VERSION_PACKED : SD_STORE_VERSION;
+        header.flags = packStrat ? SD_STORE_PACKED : 0;
+        header.maxT = maxT;
+        header.maxTs = maxTs;
+        header.maxD = maxD;
+        header.maxH = maxH;
+        header.capacity = storeCapacity;
+        header.count = 0;
+        header.stride = packStrat ? 0 : RoundUp(size_t(maxT)*maxTs*(maxD+1)*sizeof(int16_t), cacheLine);
+        header.index_offset = RoundUp(sizeof(header), cacheLine);
+        header.data_offset = RoundUp(header.index_offset + storeCapacity*sizeof(sd_store_entry), sysconf(_SC_PAGESIZE));
+    }
+    else if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || !StoreFits(header))
+    {
+        std::cerr << "Strategy store " << storeFile << " is not a store of this version and grid" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    k = header.count;
+
+    if (k == header.capacity)
+    {
+        std::cerr << "Strategy store " << storeFile << " is full, at " << k << " points" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.params[0] = pLeave;
+    entry.params[1] = pArrive;
+    entry.params[2] = pAttack;
+    entry.params[3] = alpha;
+    entry.params[4] = Kmort;
+    entry.params[5] = Kfec;
+    entry.iterations = i;
+    entry.converged = converged;
+
+    // the point first, then the count that makes it visible
+    if (header.flags & SD_STORE_PACKED)
+    {
+        // packed points differ in length, so each goes at the end of the file
+        bytes = PackStrategy();
+        entry.offset = std::max(uint64_t(info.st_size), header.data_offset);
+
+        if (pwrite(fd, &bytes[0], bytes.size(), entry.offset) != (ssize_t)bytes.size()
+                || pwrite(fd, &entry, sizeof(entry), header.index_offset + k*sizeof(entry)) != sizeof(entry))
+        {
+            std::cerr << "Cannot write to strategy store " << storeFile << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else
+    {
+        levels.assign(header.stride / sizeof(int16_t), 0);
+
         for (t=0;t<maxT;++t)
         {
-            for (d=0;d<=maxD;++d)
+            for (ts=0;ts<maxTs;++ts)
             {
-              // GOLDEN SECTION SEARCH
-              // following https://medium.datadriveninvestor.com/golden-section-search-method-peak-index-in-a-mountain-array-leetcode-852-a00f53ed4076
-              LHS = 0;
-              RHS = maxH;
-              x1 = RHS - (round((double(RHS)-double(LHS))*phi_inv));
-              x2 = LHS + (round((double(RHS)-double(LHS))*phi_inv));
-
-              while (x1<x2)
-              {
-                  // range of values of ts +1: 
-                  //    maxTs - 2 + 1 = maxTs - 1 (i.e., end of array)
-                  //    0 + 1 = 1 (i.e., one off start of array
-                  //    Wnext[ts = 0] will not be accessed
-                fitness_x1 = Wnext[std::min(maxT-1,t+1)][(ts + 1) % maxTs][d][x1];
-                fitness_x2 = Wnext[std::min(maxT-1,t+1)][(ts + 1) % maxTs][d][x2]; // fitness as a function of h=x2
-    
-                if (fitness_x1 < fitness_x2)
-                {
-                    LHS = x1;
-                    x1 = x2;
-                    x2 = RHS - (round((double(RHS)-double(x1))*phi_inv));
-                }
-                else
+                for (d=0;d<=maxD;++d)
                 {
-                    RHS = x2;
-                    x2 = x1;
-                    x1 = LHS + (round((double(x2)-double(LHS))*phi_inv));
+                    levels[(size_t(t)*maxTs + ts)*(maxD+1) + d] = hormone[t][ts][d];
                 }
-              }
-              // ts ranges here from MaxTs - 2 to 0
-              // i.e., there are no hormone, Wopt values here for MaxTs - 1
-              hormone[t][ts][d] = x1; // optimal hormone level
-              Wopt[t][ts][d] = fitness_x1; // fitness of optimal decision
-            } // end for d
-        } // end for t
-
-  // calculate expected fitness W as a function of t, h and d, before predator does/doesn't attack
-  // later on we will then set Wnext = W and see for which hormone level fitness is max
+            }
+        }
 
-        for (t=1;t<maxT;++t) // note that W is undefined for t=0 because t=1 if predator has just attacked
+        if (pwrite(fd, &levels[0], header.stride, header.data_offset + k*header.stride) != (ssize_t)header.stride
+                || pwrite(fd, &entry, sizeof(entry), header.index_offset + k*sizeof(entry)) != sizeof(entry))
         {
-            for (d=0;d<=maxD;++d)
-            {
-                for (h=0;h<maxH;++h)
-                {
-                    d1=floor(dnew[d][h]); // for linear interpolation
-                    d2=ceil(dnew[d][h]); // for linear interpolation
-                    ddec=dnew[d][h]-double(d1); // for linear interpolation
-
-                    W[t][ts][d][h] = pPred[t]*pAttack*(1.0-pKilled[h])*(1.0-mu[d])*(repro[ts][d] + 
-                            (1.0-ddec)*Wopt[0][ts][d1]+ddec*Wopt[0][ts][d2]) // survive attack
-                                + (1.0-pPred[t]*pAttack)*(1.0-mu[d])*(repro[ts][d] +
-                                        (1.0-ddec)*Wopt[t][ts][d1]+ddec*Wopt[t][ts][d2]); // no attack
-//                    std::cout << "W[" << t << "][" << ts << "][" << d << "][" << h << "] " << V[t][d][h] << " " << W[t][ts][d][h] << " " << std::endl;
-//
-                    Wnext[t][ts][d][h] = W[t][ts][d][h];
-                
-                } // end for h
-            } // end for d
-        } // end for t
-    } // end for ts
-} // end void OptDec()
+            std::cerr << "Cannot write to strategy store " << storeFile << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    header.count = k + 1;
+
+    if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+    {
+        std::cerr << "Cannot write to strategy store " << storeFile << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    close(fd); // and with it the lock
+} // end StoreAppend()
 
 
 
-/* OVERWRITE FITNESS ARRAY FROM PREVIOUS ITERATION */
-void ReplaceFit()
+/* SOLVE THE CURRENT PARAMETER POINT AND WRITE ITS OUTPUT FILES, THOSE OF --pack AND --store AS WELL; returns whether it converged */
+bool SolvePoint()
 {
-    int t,h,d,ts;
-    double fitdiff;
+    return RunPoint([]() { if (packStrat) PrintPacked(); },
+                    [](bool converged) { if (!storeFile.empty()) StoreAppend(converged); });
+} // end SolvePoint()
 
-    fitdiff = 0.0;
 
-    for (t=1;t<maxT;t++)
+
+/* READ A JOB LINE pLeave pArrive pAttack alpha Kmort Kfec INTO p; returns 0 if it is blank, -1 if it cannot be read, 1 otherwise */
+int ParseJob(std::string text, double p[6])
+{
+    int k;
+
+    // as on the command line; anything after # is a comment
+    text = text.substr(0, text.find('#'));
+
+    if (text.find_first_not_of(" \t\r") == std::string::npos) return 0;
+
+    std::istringstream in(text);
+
+    for (k=0;k<6 && in >> p[k];++k) {}
+
+    return k == 6 && (in >> std::ws).eof() ? 1 : -1;
+} // end ParseJob()
+
+
+
+/* SOLVE THE PARAMETER POINT p; returns whether it converged, and a line on how it went in report */
+bool RunJob(const double p[6], std::string &report)
+{
+    bool converged;
+    double secs;
+    std::ostringstream line;
+    std::chrono::steady_clock::time_point start;
+
+    pLeave = p[0];
+    pArrive = p[1];
+    pAttack = p[2];
+    alpha = p[3];
+    Kmort = p[4];
+    Kfec = p[5];
+
+    ResetPeakRSS();
+
+    start = std::chrono::steady_clock::now();
+    converged = SolvePoint();
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    line << pLeave << " " << pArrive << " " << pAttack << " " << alpha << " " << Kmort << " " << Kfec << "\t";
+
+    if (failKind == "invalid")
     {
-        for (d=0;d<=maxD;++d)
-        {
-            for (h=0;h<maxH;++h)
-            {
-//                std::cout << "V[" << t << "][" << d << "][" << h << "] " << V[t][d][h] << " " << W[t][0][d][h] << " " << fitdiff << std::endl;
-                fitdiff = fitdiff + fabs(V[t][d][h]-W[t][0][d][h]);
+        line << "error=invalid: " << failDetail << "\t";
+    }
+    else if (!failKind.empty())
+    {
+        line << "error=" << failKind << " at iteration " << i << ": " << failDetail << "\t";
+    }
+    else
+    {
+        line << (converged ? "converged" : "DID NOT CONVERGE") << " after " << i << " iterations\t";
+    }
 
-                Wnext[t][maxTs - 1][d][h] = W[t][0][d][h];
+    line << std::setprecision(3) << secs << " s\t" << "peak RSS " << PeakRSS() / (1 << 20) << " MB";
+    report = line.str();
 
-                V[t][d][h] = W[t][0][d][h];
-            }
+    return converged;
+} // end RunJob()
+
+
+
+/* SOLVE EVERY PARAMETER TUPLE OF THE JOB FILE IN TURN; returns the exit status */
+int RunJobs()
+{
+    int line,njobs,nfailed;
+    double p[6];
+    std::string text,report;
+    std::ifstream jobs(jobFile.c_str());
+
+    if (!jobs)
+    {
+        std::cerr << "Cannot read job file " << jobFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // one line per job rather than one per iteration
+    quiet = true;
+
+    line = 0;
+    njobs = 0;
+    nfailed = 0;
+
+    while (std::getline(jobs, text))
+    {
+        ++line;
+
+        switch (ParseJob(text, p))
+        {
+        case 0:
+            continue;
+
+        case -1:
+            std::cout << "job " << ++njobs << " (line " << line << "): expected pLeave pArrive pAttack alpha Kmort Kfec" << std::endl;
+            ++nfailed;
+            continue;
         }
+
+        ++njobs;
+
+        if (!RunJob(p, report)) ++nfailed;
+
+        std::cout << "job " << njobs << " (line " << line << ")\t" << report << std::endl;
     }
 
-    totfitdiff = fitdiff;
-} // void ReplaceFit()
+    std::cout << "jobs: " << njobs << ", failed: " << nfailed << std::endl;
 
+    return nfailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // end RunJobs()
 
 
-/* PRINT OUT OPTIMAL STRATEGY */
-void PrintStrat()
+
+// touches a claim file every so often while its job runs, so that other
+// workers can tell a live claim from one left behind by a crashed worker
+struct Heartbeat
+{
+    std::string path;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stop;
+    std::thread beat;
+};
+
+
+/* START TOUCHING path */
+void HeartbeatStart(Heartbeat &h, const std::string &path)
 {
-  int t,d,ts;
+    h.path = path;
+    h.stop = false;
 
-  outputfile << "t" << "\t" << "d" << "\t" << "ts" << "\t" << "hormone" << std::endl;
+    h.beat = std::thread([&h]() {
+        std::unique_lock<std::mutex> hold(h.lock);
 
-  for (t=0;t<maxT;++t)
-  {
-      for (ts = 0; ts < maxTs; ++ts)
-      {
-        for (d=0;d<=maxD;++d)
+        while (!h.wake.wait_for(hold, std::chrono::seconds(std::max(1, staleAfter/4)), [&h]{ return h.stop; }))
         {
-            for (ts=0;ts<maxTs;++ts)
-            {
-              outputfile << t << "\t" << d << "\t" << ts << "\t" << hormone[t][ts][d] << std::endl;
-            }
+            utimensat(AT_FDCWD, h.path.c_str(), NULL, 0);
         }
-      }
-  }
+    });
+} // end HeartbeatStart()
 
-  outputfile << std::endl;
-  outputfile << "nIterations" << "\t" << i << std::endl;
-  outputfile << std::endl;
-}
 
+/* STOP TOUCHING THE CLAIM FILE */
+void HeartbeatStop(Heartbeat &h)
+{
+    {
+        std::lock_guard<std::mutex> hold(h.lock);
+        h.stop = true;
+    }
 
+    h.wake.notify_one();
+    h.beat.join();
+} // end HeartbeatStop()
 
 
-/* WRITE PARAMETER SETTINGS TO OUTPUT FILE */
-void PrintParams()
+
+/* NAMES OF THE FILES IN dir, SORTED, LEAVING OUT HIDDEN ONES (which are still being written) */
+std::vector<std::string> ListDir(const std::string &dir)
 {
-  outputfile << std::endl << "PARAMETER VALUES" << std::endl
-       << "pLeave: " << "\t" << pLeave << std::endl
-       << "pArrive: " << "\t" << pArrive << std::endl
-       << "pAttack: " << "\t" << pAttack << std::endl
-       << "alpha: " << "\t" << alpha << std::endl
-//       << "beta: " << "\t" << beta << std::endl
-       << "mu0: " << "\t" << mu0 << std::endl
-       << "Kmort: " << "\t" << Kmort << std::endl
-       << "Kfec: " << "\t" << Kfec << std::endl
-       << "maxI: " << "\t" << maxI << std::endl
-       << "maxT: " << "\t" << maxT << std::endl
-       << "maxTs: " << "\t" << maxTs << std::endl
-       << "maxD: " << "\t" << maxD << std::endl
-       << "maxH: " << "\t" << maxH << std::endl;
-}
+    DIR *d;
+    struct dirent *entry;
+    std::vector<std::string> names;
+
+    d = opendir(dir.c_str());
+
+    while (d != NULL && (entry = readdir(d)) != NULL)
+    {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+    }
+
+    if (d != NULL) closedir(d);
+
+    std::sort(names.begin(), names.end());
 
+    return names;
+} // end ListDir()
 
 
-/* FORWARD CALCULATION TO OBTAIN PER-TIME-STEP MORTALITY FROM STRESSOR VS. DAMAGE */
-void fwdCalc()
+/* CREATE THE QUEUE DIRECTORIES IF THEY ARE NOT THERE YET */
+void QueueInit()
 {
-  int t,ts,d,h,d1,d2,h1,h2,i;
-  double ddec,predDeaths,damageDeaths,maxfreqdiff;
-
-  for (t=1;t<maxT;++t) // note that F is undefined for t=0 because t=1 if predator has just attacked
-  {
-      for (ts = 0; ts<maxTs; ++ts)
-      {
-        for (d=0;d<=maxD;++d)
-        {
-          for (h=0;h<maxH;++h)
-          {
-            F[t][ts][d][h] = 0.0;
-            Fnext[t][ts][d][h] = 0.0;
-          }
-        }
-      }
-  }
-
-  F[50][0][0][0] = 1.0; // initialise all individuals with zero damage, zero hormone and 50 time steps since last attack, during the first reproductive bout
-
-  i = 0;
-
-  maxfreqdiff = 1.0;
-
-  while (maxfreqdiff > 0.000001)
-  {
-      i++;
-      predDeaths = 0.0;
-      damageDeaths = 0.0;
-      for (t=1;t<maxT;++t) // note that F is undefined for t=0 because t=1 if predator has just attacked
-      {
-          for(ts=0; ts<maxTs;++ts)
-          { 
-            for (d=0;d<=maxD;++d)
-            {
-              for (h=0;h<maxH;++h)
-              {
-                d1=floor(dnew[d][h]); // for linear interpolation
-                d2=ceil(dnew[d][h]); // for linear interpolation
-                ddec=dnew[d][h]-double(d1); // for linear interpolation
-
-                // attack
-                h1=hormone[0][ts][d1];
-                Fnext[1][ts][d1][h1] += F[t][ts][d][h]*pPred[t]*pAttack*(1.0-pKilled[h])*(1.0-mu[d])*(1.0-ddec);
-                h2=hormone[0][ts][d2];
-                Fnext[1][ts][d2][h2] += F[t][ts][d][h]*pPred[t]*pAttack*(1.0-pKilled[h])*(1.0-mu[d])*ddec;
-                // no attack
-                h1=hormone[std::min(maxT-1,t+1)][ts][d1];
-                Fnext[std::min(maxT-1,t+1)][ts][d1][h1] += F[t][ts][d][h]*(1.0-pPred[t]*pAttack)*(1.0-mu[d])*(1.0-ddec);
-                h2=hormone[std::min(maxT-1,t+1)][ts][d2];
-                Fnext[std::min(maxT-1,t+1)][ts][d2][h2] += F[t][ts][d][h]*(1.0-pPred[t]*pAttack)*(1.0-mu[d])*ddec;
-                // deaths from predation and damage
-                predDeaths += F[t][ts][d][h]*pPred[t]*pAttack*pKilled[h];
-                damageDeaths += F[t][ts][d][h]*(1.0-pPred[t]*pAttack*pKilled[h])*mu[d];
-              } // end for h
-            } // end for d
-          } // end for ts
-      } // end for t
-
-      // NORMALISE AND OVERWRITE FREQUENCIES
-      Fnext[1][0][0][0] = Fnext[1][0][0][0]/(1.0-predDeaths-damageDeaths); // normalise
-      maxfreqdiff = abs(F[1][0][0][0] - Fnext[1][0][0][0]);
-
-      for (t=1;t<maxT;t++)
-      {
-          for (ts = 0; ts < maxTs; ++ts)
-          {
-            for (d=0;d<=maxD;d++)
-            {
-              for (h=0;h<maxH;h++)
-              {
-                Fnext[t][ts][d][h] = Fnext[t][ts][d][h]/(1.0-predDeaths-damageDeaths); // normalise
-                maxfreqdiff = std::max(maxfreqdiff,fabs(F[t][ts][d][h]-Fnext[t][ts][d][h])); // stores largest frequency difference so far
-                F[t][ts][d][h] = Fnext[t][ts][d][h]; // next time step becomes this time step
-                Fnext[t][ts][d][h] = 0.0; // wipe next time step
-              } // end for h
-            } // end for d
-          } // end for ts
-      }
-      if (i%skip==0)
-      {
-        std::cout << i << "\t" << maxfreqdiff << std::endl; // show fitness difference every 'skip' generations
-      }
-  } // end while 
-
-  ///////////////////////////////////////////////////////
-  outfile.str("");
-  outfile << "fwdCalcL";
-  outfile << std::fixed << pLeave;
-  outfile << "A";
-  outfile << std::fixed << pArrive;
-  outfile << "Kmort";
-  outfile << std::fixed << Kmort;
-  outfile << "Kfec";
-  outfile << std::fixed << Kfec;
-  outfile << ".txt";
-  std::string fwdCalcfilename = outfile.str();
-  fwdCalcfile.open(fwdCalcfilename.c_str());
-  ///////////////////////////////////////////////////////
-
-  fwdCalcfile << "SUMMARY STATS" << std::endl
-    << "predDeaths: " << "\t" << predDeaths << std::endl
-    << "damageDeaths: " << "\t" << damageDeaths << std::endl
-    << std::endl;
-
-  fwdCalcfile << "\t" << "t" << "\t" << "ts" << "\t" << "damage" << "\t" << "hormone" << "\t" << //"repro" << "\t" <<
-    "freq" << std::endl; // column headings in output file
-
-  for (t=1;t<maxT;++t)
-  {
-      for (ts = 0; ts < maxTs; ++ts)
-      {
-        for (d=0;d<=maxD;++d)
-        {
-          for (h=0;h<maxH;++h)
-          {
-            fwdCalcfile << "\t" << t << "\t" << ts << "\t" << d << "\t" << h << "\t" << std::setprecision(4) << F[t][ts][d][h] << "\t" << std::endl; // print data
-          }
-        }
-      }
-  }
-
-  fwdCalcfile.close();
-}
+    const char *sub[] = {"", "/pending", "/claimed", "/done", "/failed"};
+    int k;
 
+    for (k=0;k<5;++k)
+    {
+        if (mkdir((queueDir + sub[k]).c_str(), 0777) != 0 && errno != EEXIST)
+        {
+            std::cerr << "Cannot create " << queueDir << sub[k] << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+} // end QueueInit()
 
 
-/* Simulated series of attacks */
-void SimAttacks()
+/* PUT THE TUPLES OF THE JOB FILE INTO THE QUEUE, ONE FILE EACH; returns the exit status */
+int Enqueue()
 {
-  int i,time_i,t,d,h,d1,d2;
-  double //r,
-    ddec;
-  bool attack;
-
-  ///////////////////////////////////////////////////////
-  outfile.str("");
-  outfile << "simAttacksL";
-  outfile << std::fixed << pLeave;
-  outfile << "A";
-  outfile << std::fixed << pArrive;
-  outfile << "Kmort";
-  outfile << std::fixed << Kmort;
-  outfile << "Kfec";
-  outfile << std::fixed << Kfec;
-  outfile << ".txt";
-  std::string attsimfilename = outfile.str();
-  attsimfile.open(attsimfilename.c_str());
-  ///////////////////////////////////////////////////////
-
-  attsimfile << "time" << "\t" << "t" << "\t" << "ts" << "\t" << "damage" << "\t" << "hormone" << "\t" << "attack" << "\t" << "reproduce" << "\t" << std::endl; // column headings in output file
-
-    // initialise individual (alive, no damage, no offspring, baseline hormone level) and starting environment (predator)
-    //
-    int time_sim_max = maxTs*3;
-
-    attack = false;
-    time_i = 0; // time overall
-    t = 50; // time since attack
-   
-    // time point in between 0 and time_sim_max 
-    // at which reproduction takes place
-    int treproduce = 40;
-
-    // time since last reproductive event
-    // add +1 as we need to have ts == Tsmax - 1
-    // 1 timestep before treproduce and we start to count
-    // time from 0
-    int ts = maxTs - 1 - treproduce;
-
-    int reproduce = 0;
-
-    d = 0;
-    //    r = 0.0;
-    h = hormone[t][ts][d];
-
-    for(time_i = 0; time_i < time_sim_max; ++time_i)
-    {
-      if (time_i > 16 && time_i < 33) // predator attacks
-      {
-        t = 0;
-        attack = true;
-      }
-      else
-      {
-        t++;
-        attack = false;
-      }
-
-      if (t >= maxT -1)
-      {
-          t = maxT - 1;
-      }
-
-      h = hormone[t][ts % maxTs][d];
-
-      d1 = floor(dnew[d][h]);
-      d2 = ceil(dnew[d][h]);
-      ddec = dnew[d][h]-d1;
-
-      reproduce = ts % (maxTs - 1);
-
-      if (Uniform(mt)<ddec) d = d2; else d = d1;
-
-      attsimfile << time_i << "\t" << t << "\t" << ts << "\t" << d << "\t" << h << "\t" << attack << "\t" << reproduce << "\t" << std::endl; // print data
-      ++ts;
-    } // for time_i time sim max
-
-    std::cout << time_sim_max << std::endl;
-
-  attsimfile.close();
-
-} // end void SimAttacks()
+    int line,njobs,nbad;
+    double p[6];
+    char number[16];
+    std::string text,base,name;
+    std::ifstream jobs(jobFile.c_str());
 
+    if (!jobs)
+    {
+        std::cerr << "Cannot read job file " << jobFile << std::endl;
+        return EXIT_FAILURE;
+    }
 
-void init_params(int argc, char** argv)
+    QueueInit();
+
+    base = jobFile.substr(jobFile.find_last_of('/') + 1);
+    line = 0;
+    njobs = 0;
+    nbad = 0;
+
+    while (std::getline(jobs, text))
+    {
+        ++line;
+
+        switch (ParseJob(text, p))
+        {
+        case 0:
+            continue;
+
+        case -1:
+            std::cout << "line " << line << ": expected pLeave pArrive pAttack alpha Kmort Kfec" << std::endl;
+            ++nbad;
+            continue;
+        }
+
+        // written under a hidden name and then renamed, so that no worker sees half a job
+        snprintf(number, sizeof(number), "%05d", line);
+        name = base + "." + number;
+
+        std::ofstream job((queueDir + "/pending/." + name).c_str());
+        job << text << std::endl;
+        job.close();
+
+        if (!job || rename((queueDir + "/pending/." + name).c_str(), (queueDir + "/pending/" + name).c_str()) != 0)
+        {
+            std::cerr << "Cannot queue " << name << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        ++njobs;
+    }
+
+    std::cout << "queued " << njobs << " jobs in " << queueDir << "/pending" << std::endl;
+
+    return nbad == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // end Enqueue()
+
+
+/* MOVE CLAIMS NOT TOUCHED FOR staleAfter SECONDS BACK TO pending; returns how many live claims are left */
+int Requeue()
 {
-    pLeave = atof(argv[1]);
-    pArrive = atof(argv[2]);
-    pAttack = atof(argv[3]);
-    alpha = atof(argv[4]);
-    Kmort = atof(argv[5]);
-    Kfec = atof(argv[6]);
-} // end init_params() 
+    int k,live;
+    size_t at;
+    struct stat info;
+    std::string claim;
+    std::vector<std::string> names;
+
+    names = ListDir(queueDir + "/claimed");
+    live = 0;
+
+    for (k=0;k<(int)names.size();++k)
+    {
+        claim = queueDir + "/claimed/" + names[k];
+
+        if (stat(claim.c_str(), &info) != 0) continue; // finished or requeued meanwhile
+
+        if (time(NULL) - info.st_mtime <= staleAfter)
+        {
+            ++live;
+            continue;
+        }
+
+        // claimed/NAME@OWNER goes back to pending/NAME; of several workers
+        // doing this at once, only one rename succeeds
+        at = names[k].rfind('@');
+
+        if (rename(claim.c_str(), (queueDir + "/pending/" + names[k].substr(0, at)).c_str()) == 0)
+        {
+            std::cout << "requeued " << names[k].substr(0, at) << ", claimed by " << names[k].substr(at + 1) << std::endl;
+        }
+    }
+
+    return live;
+} // end Requeue()
+
+
+/* CLAIM, SOLVE AND FILE JOBS OF THE QUEUE UNTIL NONE ARE LEFT; returns the exit status */
+int RunQueue()
+{
+    int k,live,njobs,nfailed;
+    bool claimed,converged;
+    double p[6];
+    char host[256];
+    std::string owner,name,claim,text,report,status,outcome;
+    std::vector<std::string> names;
+    Heartbeat heart;
+
+    QueueInit();
+
+    // one line per job rather than one per iteration
+    quiet = true;
+
+    gethostname(host, sizeof(host));
+    host[sizeof(host) - 1] = '\0';
+    owner = std::string(host) + "." + std::to_string(getpid());
+
+    njobs = 0;
+    nfailed = 0;
+
+    for (;;)
+    {
+        live = Requeue();
+        names = ListDir(queueDir + "/pending");
+        claimed = false;
+
+        // a claim is a rename into claimed/, which exactly one worker wins
+        for (k=0;k<(int)names.size() && !claimed;++k)
+        {
+            name = names[k];
+            claim = queueDir + "/claimed/" + name + "@" + owner;
+            claimed = rename((queueDir + "/pending/" + name).c_str(), claim.c_str()) == 0;
+        }
+
+        // rename keeps the time the job was queued, which would make the claim look stale
+        if (claimed) utimensat(AT_FDCWD, claim.c_str(), NULL, 0);
+
+        if (!claimed)
+        {
+            // done once nothing is pending and no other worker is busy;
+            // otherwise wait, in case a busy worker dies and its job comes back
+            if (names.empty() && live == 0) break;
+
+            std::this_thread::sleep_for(std::chrono::seconds(std::max(1, std::min(10, staleAfter/4))));
+            continue;
+        }
+
+        std::ifstream job(claim.c_str());
+        std::getline(job, text);
+        job.close();
+
+        ++njobs;
+
+        if (ParseJob(text, p) != 1)
+        {
+            converged = false;
+            report = "expected pLeave pArrive pAttack alpha Kmort Kfec";
+        }
+        else
+        {
+            HeartbeatStart(heart, claim);
+            converged = RunJob(p, report);
+            HeartbeatStop(heart);
+        }
+
+        if (!converged) ++nfailed;
+
+        // record how it went in the job file, and file it
+        std::ofstream out(claim.c_str(), std::ios::app);
+        out << "# " << owner << "\t" << report << std::endl;
+        out.close();
+
+        outcome = converged ? "done" : "failed";
+
+        if (rename(claim.c_str(), (queueDir + "/" + outcome + "/" + name).c_str()) != 0)
+        {
+            outcome = "claim lost, as it was taken to be stale";
+        }
+
+        std::cout << "job " << name << "\t" << report << "\t" << outcome << std::endl;
+    }
+
+    std::cout << "worker " << owner << ": " << njobs << " jobs, failed: " << nfailed << std::endl;
+
+    return nfailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // end RunQueue()
+
+
 
 /* MAIN PROGRAM */
 int main(int argc, char** argv)
 {
-    init_params(argc, argv);
+    int first,status;
+
+    // the parameters come first, unless they come from a job file
+    first = argc > 1 && std::string(argv[1]).compare(0, 2, "--") == 0 ? 1 : 7;
+
+    if (first == 7 && argc < 7)
+    {
+        std::cerr << "Usage: " << argv[0] << " pLeave pArrive pAttack alpha Kmort Kfec [--option=value ...]" << std::endl
+            << "       " << argv[0] << " --jobs=FILE [--option=value ...]" << std::endl
+            << "       " << argv[0] << " --queue=DIR [--jobs=FILE | --stale=SECONDS --option=value ...]" << std::endl
+            << "       " << argv[0] << " ... --procs=K --rank=R --shm=NAME, once for each R" << std::endl
+            << "       " << argv[0] << " --footprint [--option=value ...]" << std::endl
+            << "       " << argv[0] << " pLeave pArrive pAttack alpha Kmort Kfec --horizon=N [--option=value ...]" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-		///////////////////////////////////////////////////////
-		outfile.str("");
-		outfile << "stressL";
-		outfile << std::fixed << pLeave;
-		outfile << "A";
-		outfile << std::fixed << pArrive;
-		outfile << "Kmort";
-		outfile << std::fixed << Kmort;
-		outfile << "Kfec";
-		outfile << std::fixed << Kfec;
-		outfile << ".txt";
-        std::string outputfilename = outfile.str();
-		outputfile.open(outputfilename.c_str());
-		///////////////////////////////////////////////////////
+    if (first == 7) init_params(argc, argv);
+    init_options(argc, argv, first);
 
-        outputfile << "Random seed: " << seed << std::endl; // write seed to output file
+    if (footprint)
+    {
+        return PrintFootprint();
+    }
 
-        Reproduction();
-        FinalFit();
-        PredProb();
-        Predation();
-        Mortality();
-        Damage();
+    if (first == 1 && jobFile.empty() && queueDir.empty())
+    {
+        std::cerr << "Without parameters on the command line, --jobs=FILE or --queue=DIR must give them" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-        std::cout << "i" << "\t" << "totfitdiff" << "\t" << std::endl;
+    // --queue with --jobs only fills the queue
+    if (!queueDir.empty() && !jobFile.empty())
+    {
+        return Enqueue();
+    }
 
-        for (i=1;i<=maxI;++i)
-        {
-            OptDec();
-            ReplaceFit();
+    // the first process of a group speaks for all of them
+    if (procs > 1 && rank > 0)
+    {
+        quiet = true;
+        std::cout.setstate(std::ios::failbit);
+    }
 
+    if (!storeFile.empty()) init_store();
 
- 		  if (i%skip==0 || totfitdiff < 0.000001)
-            {
-              std::cout << i << "\t" << totfitdiff << std::endl; // show fitness difference every 'skip' generations
-            }
-          
-          if (totfitdiff < 0.000001) break; // strategy has converged on optimal solution, so exit loop
+    init_threads();
+    init_arena();
 
-          if (i==maxI) { outputfile << "*** DID NOT CONVERGE WITHIN " << i << " ITERATIONS ***" << std::endl;}
-          }
+    if (!queueDir.empty())
+    {
+        status = RunQueue();
+    }
+    else if (!jobFile.empty())
+    {
+        status = RunJobs();
+    }
+    else
+    {
+        SolvePoint();
+        status = EXIT_SUCCESS;
 
-        std::cout << std::endl;
-        outputfile << std::endl;
+        std::cout << "peak RSS: " << PeakRSS() / (1 << 20) << " MB" << std::endl;
 
-        PrintStrat();
-        PrintParams();
-        outputfile.close();
+        if (!failKind.empty())
+        {
+            std::cerr << "Point given up (" << failKind << "): " << failDetail << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
 
-//        fwdCalc();
-        SimAttacks();
+    TeamStop();
 
-  return 0;
+  return status;
 }
@@ -0,0 +1,3812 @@
+// **********************************************************************************
+// Dynamic programming model of stress response with somatic damage.
+//
+// fecundity and seasonality: the engine, shared by the programs in
+// stress_damage_lh.cpp and stress_damage.cpp (survival only, a single ts),
+// the solve server in stress_damage_server.cpp and the C API of
+// libstress_damage.so in stress_damage_api.cpp
+//
+// June 2021, Exeter
+// **********************************************************************************
+
+
+#ifndef STRESS_DAMAGE_LH_HPP
+#define STRESS_DAMAGE_LH_HPP
+
+//HEADER FILES
+
+#include <cstdlib>
+#include <stdio.h>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// constants, type definitions, etc.
+inline const int seed        = std::time(0); // pseudo-random seed
+
+inline double pLeave;   // probability that predator leaves
+inline double pArrive;  // probability that predator arrives
+inline double pAttack  = 0.5;     // probability that predator attacks if present
+inline double alpha    = 1.0;     // parameter controlling effect of hormone level on pKilled
+//const double beta     = 1.5;     // parameter controlling effect of hormone level on reproductive rate
+inline constexpr double mu0  = 0.002;   // background mortality (independent of hormone level and predation risk)
+inline const double phi_inv  = 1.0/((sqrt(5.0)+1.0)/2.0); // inverse of golden ratio (for golden section search)
+inline int maxD              = 20;      // maximum damage level (--maxD)
+inline double Kmort        = 0.0;    // parameter Kmort controlling increase in mortality with damage level
+inline double Kfec        = 0.05;    // parameter Kmort controlling increase in mortality with damage level
+inline const int maxI        = 1000000; // maximum number of iterations
+inline int maxT              = 100;     // maximum number of time steps since last saw predator (--maxT)
+inline int maxH              = 500;     // maximum hormone level (--maxH)
+inline int skip              = 1;       // interval between print-outs of the iterations
+inline int maxTs = 10; // duration of a season (--maxTs)
+
+inline std::ofstream outputfile;  // output file
+inline std::ofstream fwdCalcfile; // forward calculation output file
+inline std::ofstream attsimfile;  // simulated attacks output file
+inline std::stringstream outfile; // for naming output file
+
+// random numbers
+inline std::mt19937 mt(seed); // random number generator
+inline std::uniform_real_distribution<double> Uniform(0, 1); // real number between 0 and 1 (uniform)
+
+inline const double tol      = 0.000001; // convergence tolerance of value iteration and forward calculation
+inline const double floatTol = 0.0001;   // tolerance of the single precision phase of --precision=mixed
+inline const int floatStall  = 20;       // successive iterations without a decrease in residual before the single precision phase stops
+inline const int watchGrowth = 8;        // successive iterations in which the largest change in V grows before the point is given up as diverging
+inline const double watchSlack = 0.05;   // relative growth of the largest change in V that counts towards watchGrowth
+inline const int watchStall  = 200;      // iterations without a new low in the largest change in V before the point is given up as stagnant
+
+inline const size_t hugePage = size_t(2) << 20; // size of a huge page
+inline const size_t cacheLine = 64;             // alignment of every buffer in the arena
+
+// one contiguous region holding every solver buffer. It is mapped once,
+// backed by 2 MB huge pages where possible, and buffers are handed out
+// stack-wise and handed back for reuse rather than freed
+struct Arena
+{
+    char *base;      // start of the region
+    size_t capacity; // bytes mapped
+    size_t used;     // bytes handed out
+    bool hugetlb;    // whether the region came from the huge page pool
+    int fd;          // sparse file on scratch that backs the region, or -1 if it is anonymous memory
+    size_t clean;    // bytes beyond this have never been handed out, so still read as zero
+};
+
+inline Arena arena = {NULL, 0, 0, false, -1, 0};
+
+inline std::string scratch;   // --scratch=DIR: back the arena by a file in DIR rather than by memory
+inline size_t rssBudget = 0;  // --rss-budget=MB: bytes of the bulk tensors that may stay mapped at once; 0 for no limit
+inline std::string arenaError; // why ArenaReserve() or ArenaTake() last failed
+
+
+/* ROUND bytes UP TO A MULTIPLE OF align */
+inline size_t RoundUp(size_t bytes, size_t align)
+{
+    return (bytes + align - 1) / align * align;
+} // end RoundUp()
+
+
+/* MAP A REGION OF AT LEAST bytes FOR THE ARENA, UNLESS THE CURRENT ONE IS LARGE ENOUGH; false, with
+   the reason in arenaError and no arena left, if it cannot be mapped */
+inline bool ArenaReserve(size_t bytes)
+{
+    void *p;
+    char *aligned;
+    size_t mapped;
+    std::ostringstream why;
+
+    if (bytes <= arena.capacity) return true;
+
+    if (arena.base != NULL)
+    {
+        munmap(arena.base, arena.capacity);
+        arena.base = NULL;
+        arena.capacity = 0;
+    }
+
+    if (arena.fd >= 0)
+    {
+        close(arena.fd);
+        arena.fd = -1;
+    }
+
+    bytes = RoundUp(bytes, hugePage);
+    arena.used = 0;
+    arena.clean = 0;
+
+    // grids too large for memory live in a sparse file on local scratch; the
+    // file is unlinked at once, so that it goes away with the process
+    if (!scratch.empty())
+    {
+        std::string path = scratch + "/stress_damage_XXXXXX";
+        std::vector<char> name(path.begin(), path.end());
+        name.push_back('\0');
+
+        arena.fd = mkstemp(&name[0]);
+
+        if (arena.fd < 0 || unlink(&name[0]) != 0 || ftruncate(arena.fd, bytes) != 0)
+        {
+            why << "Cannot create a scratch file of " << bytes << " bytes in " << scratch;
+            arenaError = why.str();
+            if (arena.fd >= 0) close(arena.fd);
+            arena.fd = -1;
+            return false;
+        }
+
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, arena.fd, 0);
+
+        if (p == MAP_FAILED)
+        {
+            arenaError = "Cannot map the scratch file in " + scratch;
+            close(arena.fd);
+            arena.fd = -1;
+            return false;
+        }
+
+        // the sweeps walk the tensors slice by slice
+        madvise(p, bytes, MADV_SEQUENTIAL);
+
+        arena.base = (char *)p;
+        arena.capacity = bytes;
+        arena.hugetlb = false;
+        return true;
+    }
+
+    // explicit huge pages, if the administrator has set enough aside (without
+    // MAP_NORESERVE, so that a short pool fails here rather than on first touch)
+    p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (p != MAP_FAILED)
+    {
+        arena.base = (char *)p;
+        arena.capacity = bytes;
+        arena.hugetlb = true;
+    }
+    else
+    {
+        // otherwise ordinary pages, aligned to a huge page boundary so that
+        // transparent huge pages can back the whole region
+        mapped = bytes + hugePage;
+        p = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (p == MAP_FAILED)
+        {
+            why << "Cannot map " << bytes << " bytes for the solver arrays";
+            arenaError = why.str();
+            return false;
+        }
+
+        aligned = (char *)RoundUp((size_t)p, hugePage);
+
+        if (aligned > (char *)p) munmap(p, aligned - (char *)p);
+        munmap(aligned + bytes, (char *)p + mapped - (aligned + bytes));
+
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, bytes, MADV_HUGEPAGE);
+#endif
+
+        arena.base = aligned;
+        arena.capacity = bytes;
+        arena.hugetlb = false;
+    }
+
+    return true;
+} // end ArenaReserve()
+
+
+/* HAND OUT bytes FROM THE ARENA; NULL, with the reason in arenaError, if they go beyond what was
+   reserved, which cannot happen to a point that reserved Footprint() */
+inline void *ArenaTake(size_t bytes)
+{
+    size_t offset;
+    std::ostringstream why;
+
+    offset = RoundUp(arena.used, cacheLine);
+
+    if (offset + bytes > arena.capacity)
+    {
+        why << "Solver arrays need more than the " << arena.capacity << " bytes reserved";
+        arenaError = why.str();
+        return NULL;
+    }
+
+    arena.used = offset + bytes;
+    arena.clean = std::max(arena.clean, arena.used);
+
+    return arena.base + offset;
+} // end ArenaTake()
+
+
+/* WHETHER THE NEXT BUFFER HANDED OUT IS A HOLE IN THE SCRATCH FILE, SO THAT IT NEED NOT BE ZEROED */
+inline bool ArenaSparse()
+{
+    return arena.fd >= 0 && RoundUp(arena.used, cacheLine) >= arena.clean;
+} // end ArenaSparse()
+
+
+/* ADVISE THE KERNEL ABOUT THE PAGES OF THE SCRATCH FILE BETWEEN begin AND end */
+inline void ArenaAdvise(const void *begin, const void *end, int advice)
+{
+    size_t page,lo,hi;
+
+    if (arena.fd < 0) return;
+
+    page = sysconf(_SC_PAGESIZE);
+    lo = ((const char *)begin - arena.base) / page * page;
+    hi = std::min(arena.capacity, RoundUp((const char *)end - arena.base, page));
+
+    if (lo >= hi) return;
+
+    // start writing dropped pages back, so that the page cache can let them go too
+    if (advice == MADV_DONTNEED)
+    {
+        sync_file_range(arena.fd, lo, hi - lo, SYNC_FILE_RANGE_WRITE);
+    }
+
+    // on a shared file mapping MADV_DONTNEED only unmaps: the data stays in the file
+    madvise(arena.base + lo, hi - lo, advice);
+} // end ArenaAdvise()
+
+
+/* HAND BACK EVERYTHING TAKEN SINCE mark, FOR REUSE */
+inline void ArenaRelease(size_t mark)
+{
+    arena.used = mark;
+} // end ArenaRelease()
+
+
+inline const int maxProcs = 256; // largest number of processes in a group
+
+// processes that share the sweeps of one solve, one thread each: they map the
+// same POSIX shared memory object, which holds this block followed by the
+// arena, and as they take their buffers from the arena in the same order,
+// every tensor sits at the same offset in all of them
+struct Group
+{
+    std::atomic<int> ready;   // set by the first process once the rest is initialised
+    int procs;                // number of processes
+    size_t bytes;             // bytes of the object
+    pthread_barrier_t barrier;
+    double partial[2*maxProcs]; // per-process partial sums, then per-process maxima
+};
+
+// threads that share the sweeps over t. Each thread owns one contiguous
+// block of t rows for the whole run: it is the first to touch them, so that
+// on a multi-socket machine their pages sit on its own node, and every
+// parallel loop hands it the same rows again. Thread 0 is the main thread
+struct Team
+{
+    int n;                              // number of threads
+    std::vector<std::thread> workers;   // threads 1, ..., n-1
+    std::vector<int> cpus;              // CPU each thread is pinned to; empty if not pinned
+    std::mutex lock;
+    std::condition_variable wake;       // a job has been posted, or the team is stopping
+    std::condition_variable idle;       // every worker has finished the job
+    std::condition_variable pass;       // every thread has reached the barrier
+    std::function<void(int)> job;       // run by every thread with its index
+    unsigned long round;                // number of jobs posted
+    int running;                        // workers still running the job
+    int arrived;                        // threads waiting at the barrier
+    unsigned long phase;                // number of barriers passed
+    bool quit;                          // whether the workers should exit
+    std::vector<double> partials;       // per-thread partial sums, then per-thread maxima
+    double *partial;                    // per-member partial sums and maxima: partials, or those of the group
+    Group *group;                       // group of processes the team stands for, or NULL if it is threads
+    int rank;                           // index of this process in the group
+};
+
+inline Team team;
+
+
+/* CPUS IN A SYSFS LIST SUCH AS 0-3,8-11 */
+inline std::vector<int> ParseCpuList(const std::string &list)
+{
+    int lo,hi,cpu;
+    std::string range;
+    std::stringstream in(list);
+    std::vector<int> cpus;
+
+    while (std::getline(in, range, ','))
+    {
+        if (sscanf(range.c_str(), "%d-%d", &lo, &hi) == 2) {}
+        else if (sscanf(range.c_str(), "%d", &lo) == 1) hi = lo;
+        else continue;
+
+        for (cpu=lo;cpu<=hi;++cpu) cpus.push_back(cpu);
+    }
+
+    return cpus;
+} // end ParseCpuList()
+
+
+/* CPUS OF EACH NUMA NODE THAT THIS PROCESS MAY RUN ON, INDEXED BY NODE NUMBER */
+inline std::vector<std::vector<int> > Nodes()
+{
+    int k,cpu;
+    DIR *dir;
+    struct dirent *entry;
+    cpu_set_t allowed;
+    std::string list;
+    std::vector<int> cpus;
+    std::vector<std::vector<int> > nodes;
+
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    // read from sysfs rather than libnuma, so that this builds anywhere
+    dir = opendir("/sys/devices/system/node");
+
+    while (dir != NULL && (entry = readdir(dir)) != NULL)
+    {
+        if (sscanf(entry->d_name, "node%d", &k) != 1) continue;
+
+        std::ifstream in((std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist").c_str());
+        std::getline(in, list);
+        cpus = ParseCpuList(list);
+
+        if (k >= (int)nodes.size()) nodes.resize(k + 1);
+
+        for (cpu=0;cpu<(int)cpus.size();++cpu)
+        {
+            if (CPU_ISSET(cpus[cpu], &allowed)) nodes[k].push_back(cpus[cpu]);
+        }
+    }
+
+    if (dir != NULL) closedir(dir);
+
+    // no NUMA information: a single node of every CPU allowed
+    if (nodes.empty())
+    {
+        nodes.resize(1);
+
+        for (cpu=0;cpu<CPU_SETSIZE;++cpu)
+        {
+            if (CPU_ISSET(cpu, &allowed)) nodes[0].push_back(cpu);
+        }
+    }
+
+    return nodes;
+} // end Nodes()
+
+
+/* LET THE CALLING THREAD RUN ONLY ON cpus */
+inline void SetAffinity(const std::vector<int> &cpus)
+{
+    int k;
+    cpu_set_t mask;
+
+    CPU_ZERO(&mask);
+
+    for (k=0;k<(int)cpus.size();++k) CPU_SET(cpus[k], &mask);
+
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0)
+    {
+        std::cerr << "Cannot set CPU affinity" << std::endl;
+    }
+} // end SetAffinity()
+
+
+/* LOOP OF WORKER THREAD id: RUN EVERY JOB POSTED UNTIL THE TEAM STOPS */
+inline void TeamWorker(int id)
+{
+    unsigned long seen;
+
+    if (!team.cpus.empty()) SetAffinity(std::vector<int>(1, team.cpus[id]));
+
+    seen = 0;
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> hold(team.lock);
+        team.wake.wait(hold, [&seen]{ return team.quit || team.round != seen; });
+
+        if (team.quit) return;
+
+        seen = team.round;
+        hold.unlock();
+
+        team.job(id);
+
+        hold.lock();
+        if (--team.running == 0) team.idle.notify_one();
+    }
+} // end TeamWorker()
+
+
+/* START A TEAM OF n THREADS, PINNED TO cpus ROUND ROBIN IF THAT IS NOT EMPTY */
+inline void TeamStart(int n, const std::vector<int> &cpus)
+{
+    int id;
+
+    // every thread needs at least one t row
+    team.n = std::max(1, std::min(n, maxT - 1));
+    team.round = 0;
+    team.running = 0;
+    team.arrived = 0;
+    team.phase = 0;
+    team.quit = false;
+    team.partials.assign(2*team.n, 0.0);
+    team.partial = &team.partials[0];
+
+    for (id=0;id<team.n && !cpus.empty();++id)
+    {
+        team.cpus.push_back(cpus[id % cpus.size()]);
+    }
+
+    if (!team.cpus.empty()) SetAffinity(std::vector<int>(1, team.cpus[0]));
+
+    for (id=1;id<team.n;++id)
+    {
+        team.workers.push_back(std::thread(TeamWorker, id));
+    }
+} // end TeamStart()
+
+
+/* STOP AND JOIN THE WORKER THREADS */
+inline void TeamStop()
+{
+    int id;
+
+    {
+        std::lock_guard<std::mutex> hold(team.lock);
+        team.quit = true;
+    }
+
+    team.wake.notify_all();
+
+    for (id=0;id<(int)team.workers.size();++id) team.workers[id].join();
+
+    team.workers.clear();
+    team.cpus.clear();
+} // end TeamStop()
+
+
+/* WAIT UNTIL EVERY PROCESS OF THE GROUP HAS GOT HERE */
+inline void GroupSync()
+{
+    pthread_barrier_wait(&team.group->barrier);
+} // end GroupSync()
+
+
+/* RUN job(id) ON EVERY THREAD OF THE TEAM AND WAIT UNTIL ALL HAVE FINISHED */
+inline void TeamRun(const std::function<void(int)> &job)
+{
+    if (team.n == 1)
+    {
+        job(0);
+        return;
+    }
+
+    // every process of a group gets here, and runs its own part
+    if (team.group != NULL)
+    {
+        job(team.rank);
+        GroupSync();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> hold(team.lock);
+        team.job = job;
+        team.running = team.n - 1;
+        ++team.round;
+    }
+
+    team.wake.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> hold(team.lock);
+    team.idle.wait(hold, []{ return team.running == 0; });
+} // end TeamRun()
+
+
+/* WAIT INSIDE A JOB UNTIL EVERY THREAD OF THE TEAM HAS GOT HERE */
+inline void TeamSync()
+{
+    unsigned long phase;
+
+    if (team.n == 1) return;
+
+    if (team.group != NULL)
+    {
+        GroupSync();
+        return;
+    }
+
+    std::unique_lock<std::mutex> hold(team.lock);
+    phase = team.phase;
+
+    if (++team.arrived == team.n)
+    {
+        team.arrived = 0;
+        ++team.phase;
+        team.pass.notify_all();
+    }
+    else
+    {
+        team.pass.wait(hold, [phase]{ return team.phase != phase; });
+    }
+} // end TeamSync()
+
+
+/* RUN job ON ITS OWN IN THE FIRST PROCESS OF A GROUP WHILE THE OTHERS WAIT; without a group, just run it */
+inline void TeamLead(const std::function<void()> &job)
+{
+    int n;
+
+    if (team.group == NULL)
+    {
+        job();
+        return;
+    }
+
+    if (team.rank == 0)
+    {
+        n = team.n;
+        team.n = 1; // a team of one, which reaches every row of the shared arrays
+        job();
+        team.n = n;
+    }
+
+    GroupSync();
+} // end TeamLead()
+
+
+/* JOIN PROCESS rank OF A GROUP OF procs SHARING THE OBJECT name, WITH AN ARENA OF bytes */
+inline void GroupJoin(const std::string &name, int procs, int rank, size_t bytes)
+{
+    int fd,wait;
+    size_t header,total;
+    void *p;
+    struct stat info;
+    pthread_barrierattr_t attr;
+    Group *g;
+
+    // the arena starts on a huge page boundary, as in ArenaReserve()
+    header = RoundUp(sizeof(Group), hugePage);
+    total = header + RoundUp(bytes, hugePage);
+
+    if (rank == 0)
+    {
+        // O_EXCL, so that no process of an earlier group that crashed joins this one
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+        if (fd < 0 || ftruncate(fd, total) != 0)
+        {
+            std::cerr << "Cannot create shared memory " << name << (errno == EEXIST ? ", which is left over from an earlier run: remove /dev/shm" + name : "") << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else
+    {
+        // the first process may not have started yet
+        for (wait=0; (fd = shm_open(name.c_str(), O_RDWR, 0)) < 0 || fstat(fd, &info) != 0 || info.st_size == 0; ++wait)
+        {
+            if (fd >= 0) close(fd);
+
+            if (wait == 60000)
+            {
+                std::cerr << "No process 0 has created shared memory " << name << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    p = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED)
+    {
+        std::cerr << "Cannot map shared memory " << name << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    g = (Group *)p;
+
+    if (rank == 0)
+    {
+        g->procs = procs;
+        g->bytes = total;
+
+        pthread_barrierattr_init(&attr);
+        pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_barrier_init(&g->barrier, &attr, procs);
+        pthread_barrierattr_destroy(&attr);
+
+        g->ready.store(1);
+    }
+    else
+    {
+        while (g->ready.load() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (g->procs != procs || g->bytes != total)
+        {
+            std::cerr << "Shared memory " << name << " belongs to a group of other processes or another grid" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    team.group = g;
+    team.rank = rank;
+    team.n = procs;
+    team.partial = g->partial;
+
+    arena.base = (char *)p + header;
+    arena.capacity = total - header;
+    arena.used = 0;
+    arena.clean = 0;
+    arena.hugetlb = false;
+    arena.fd = -1;
+
+    // once everybody has it mapped, the name can go, so that nothing is left behind
+    GroupSync();
+
+    if (rank == 0) shm_unlink(name.c_str());
+} // end GroupJoin()
+
+
+/* t ROWS tlo, ..., thi-1 OWNED BY THREAD id: ROWS 1, ..., maxT-1 ARE SPLIT EVENLY AND THREAD 0 ALSO OWNS t=0 */
+inline void TBlock(int id, int &tlo, int &thi)
+{
+    tlo = id == 0 ? 0 : 1 + (maxT-1)*id/team.n;
+    thi = 1 + (maxT-1)*(id+1)/team.n;
+} // end TBlock()
+
+
+// flat array of the smaller tables, indexed [i][j][k] and
+// taken from the arena; the scalar type is a template parameter
+// so that the value iteration can run in single precision
+template <typename T>
+struct Tensor3
+{
+    T *data;
+    size_t n0, s0, s1; // extent of i, strides of i and j
+    bool sparse;       // still a hole in the scratch file, so already zero
+
+    // a[i] gives a row pointer proxy, so that a[i][j][k] reads as for nested arrays
+    struct Slice
+    {
+        T *p;
+        size_t s1;
+        T *operator[](int j) const { return p + j*s1; }
+    };
+
+    Tensor3() : data(NULL), n0(0), s0(0), s1(0), sparse(false) {}
+
+    static size_t Bytes(int n0, int n1, int n2) { return size_t(n0)*n1*n2*sizeof(T); }
+
+    void Alloc(int i0, int n1, int n2)
+    {
+        n0 = i0;
+        s1 = n2;
+        s0 = size_t(n1)*n2;
+        sparse = ArenaSparse();
+        data = (T *)ArenaTake(Bytes(i0, n1, n2)); // not touched here: see FirstTouch()
+    }
+
+    size_t size() const { return n0*s0; }
+
+    Slice operator[](int i) const { Slice s = {data + i*s0, s1}; return s; }
+};
+
+// flat array of the bulk tensors, indexed (t,ts,d,h) and taken from the arena.
+// Rows over h are always contiguous; the natural layout stores all ts of one t
+// together, the blocked layout stores each ts slice contiguously, which is what
+// a backward sweep over ts touches
+template <typename Real>
+struct Tensor4
+{
+    Real *data;
+    size_t sT, sTs, sD; // strides of t, ts and d
+    bool sparse;        // still a hole in the scratch file, so already zero
+
+    Tensor4() : data(NULL), sT(0), sTs(0), sD(0), sparse(false) {}
+
+    static size_t Bytes() { return size_t(maxT)*maxTs*(maxD+1)*maxH*sizeof(Real); }
+
+    void Alloc(bool blocked)
+    {
+        sD = maxH;
+
+        if (blocked)
+        {
+            sT = (maxD+1)*sD;
+            sTs = maxT*sT;
+        }
+        else
+        {
+            sTs = (maxD+1)*sD;
+            sT = maxTs*sTs;
+        }
+
+        sparse = ArenaSparse();
+        data = (Real *)ArenaTake(Bytes()); // not touched here: see FirstTouch()
+    }
+
+    bool empty() const { return data == NULL; }
+
+    Real *Row(int t, int ts, int d) { return data + t*sT + ts*sTs + d*sD; }
+
+    Real &operator()(int t, int ts, int d, int h) { return data[t*sT + ts*sTs + d*sD + h]; }
+};
+
+
+///int hormone[maxT][maxTs][maxD+1];        // hormone level (strategy)
+inline Tensor3<int> hormone;
+inline Tensor3<int> hormoneFloat;        // strategy of the single precision phase of --precision=mixed
+
+// table indexed [i][j], sized once the grid extents are known
+template <typename T>
+struct Table2
+{
+    std::vector<T> data;
+    size_t n1; // extent of j
+
+    void Resize(int n0, int j1) { n1 = j1; data.assign(size_t(n0)*n1, T(0)); }
+
+    T *operator[](int i) { return &data[i*n1]; }
+};
+
+inline std::vector<double> pKilled;      // probability of being killed by an attacking predator [maxH]
+inline std::vector<double> mu;           // probability of background mortality, as a function of damage [maxD+1]
+inline Table2<double> dnew;              // new damage level, as a function of previous damage and hormone [maxD+1][maxH]
+inline Table2<int> dlow;                 // damage level just below dnew, for linear interpolation
+inline Table2<int> dhigh;                // damage level just above dnew, for linear interpolation
+inline Table2<double> dfrac;             // weight of dhigh in the linear interpolation
+inline Table2<double> repro;             // reproductive output [maxTs][maxD+1]
+inline std::vector<int> hLow;            // lowest hormone level the search for the optimal h looks at, as a function of damage [maxD+1]
+//double Wopt[maxT][maxTs][maxD+1];        // fitness immediately after predator has/hasn't attacked, under optimal decision h
+//double W[maxT][maxTs][maxD+1][maxH];     // expected fitness at start of time step, before predator does/doesn't attack
+//double Wnext[maxT][maxTs][maxD+1][maxH]; // expected fitness at start of next time step
+//
+//double F[maxT][maxTs][maxD+1][maxH];     // frequency of individuals at start of time step, before predator does/doesn't attack
+//double Fnext[maxT][maxTs][maxD+1][maxH]; // frequency of individuals at start of next time step
+
+// bulk arrays of the value iteration and the forward calculation;
+// taken from the arena on demand, so that only the precision in use takes up memory
+template <typename Real>
+struct Tensors
+{
+    Tensor3<Real> Wopt;  // fitness immediately after predator has/hasn't attacked, under optimal decision h
+    Tensor4<Real> W;     // expected fitness at start of time step, before predator does/doesn't attack
+    Tensor3<Real> V;     // reproductive value
+    Tensor4<Real> Wnext; // expected fitness at start of next time step
+    Tensor4<Real> F;     // frequency of individuals at start of time step, before predator does/doesn't attack
+    Tensor4<Real> Fnext; // frequency of individuals at start of next time step
+};
+
+inline std::vector<double> pPred;        // probability that predator is present [maxT]
+inline double totfitdiff;                // fitness difference between optimal strategy in successive iterations
+inline double maxfitdiff;                // largest difference of a single fitness value between successive iterations
+inline double fitBound;                  // bound on how far V still is from the optimal fitness, with --stop=policy
+inline std::string stoppedBy;            // criterion that ended the last value iteration: residual, policy or none
+inline std::string failKind;             // why the last point was given up: invalid, nan, divergence or stagnation; empty if it was not
+inline std::string failDetail;           // and what gave it away
+inline double predDeaths;                // per-time-step deaths from predation in the forward calculation
+inline double damageDeaths;              // per-time-step deaths from damage in the forward calculation
+inline std::vector<double> damageDist;   // stationary distribution of damage levels in the forward calculation [maxD+1]
+inline std::vector<double> hormoneDist;  // stationary distribution of hormone levels in the forward calculation [maxH]
+inline double meanT;                     // mean time since the last attack in the forward calculation
+inline Table2<double> freqDT;            // stationary frequencies summed over ts and h [maxD+1][maxT]
+inline Table2<double> freqDH;            // stationary frequencies summed over t and ts [maxD+1][maxH]
+
+inline int i;     // iteration
+inline int iFloat = 0; // iterations done in single precision
+
+inline std::string precision = "double"; // scalar type of the bulk tensors: double or mixed
+inline bool inPlace = false;             // --update=gauss-seidel: OptDec() updates W in place rather than reading the previous iteration's Wnext
+inline std::string stopRule = "residual"; // --stop=policy: stop as well once the strategy has stood still and V is provably within tol of the optimum
+inline int stableIters = 10;             // --stable=K: iterations for which the strategy must not have changed, with --stop=policy
+inline std::string search = "golden";    // --search=pruned: start the search for the optimal h of each d at hLow[d] rather than at 0; exhaustive: look at every h
+inline std::vector<int> tOrder;          // order in which a sweep visits t = 1, ..., maxT-1
+inline std::vector<int> dOrder;          // order in which a sweep visits d = 0, ..., maxD
+inline bool blocked = false;             // --layout=blocked: store each ts slice of the bulk tensors contiguously
+inline int tileT = 8;                    // number of t rows that OptDec() searches and then fills in one go
+inline bool runFwdCalc = false;          // whether to do the forward calculation
+inline bool fwdDump = false;             // --fwdcalc=full: write every frequency of the forward calculation, not just its marginals
+inline bool gridDump = true;             // whether RunPoint() writes the strategy and marginals as dense grids to gridsL*.bin
+inline bool packStrat = false;           // --pack: write the strategy packed to stratL*.sdp rather than as rows of stressL*.txt
+inline int horizon = 0;                  // --horizon=N: a lifespan of N seasons, solved in one backward pass rather than iterated to the fixed point
+inline long nLives = 0;                  // --lives=N: simulate N lives and write a summary of them to simSummaryL*.txt
+inline std::string simEngine = "step";    // --sim=step|event|batch: how the lives of --lives are simulated
+inline double startFit;                  // Wopt where simulated lives start, at t = maxT-1, ts = 0, d = 0
+inline bool keepFit = false;             // whether the fitness arrays stay in the arena through the forward calculation
+inline bool seasonal = true;             // whether the output files have ts columns and maxTs; not so for the survival-only program of stress_damage.cpp
+inline bool quiet = false;               // whether to keep progress off the console
+inline bool tRedBlack = false;           // --order-t=red-black
+inline int nThreads = 1;                 // number of threads sharing the sweeps
+inline bool pin = false;                 // --pin: pin each thread to one CPU, filling one node before the next
+inline int node = -1;                    // --node=N: run on, and so allocate from, NUMA node N only
+
+
+// Season policies of the backward sweep: how many ts a season has and
+// which one follows ts. Seasons is the seasonal model of maxTs steps;
+// OneSeason is maxTs = 1, the survival-only model, where both are constants,
+// so that the modulo, the loop over ts and the wrap compile away
+struct Seasons
+{
+    static int Count() { return maxTs; }
+    static int Next(int ts) { return (ts + 1) % maxTs; }
+};
+
+struct OneSeason
+{
+    static constexpr int Count() { return 1; }
+    static constexpr int Next(int) { return 0; }
+};
+
+
+/* WHETHER OptDec() NEEDS THE PREVIOUS ITERATION'S FITNESS IN A SEPARATE ARRAY, WITH THE SEASONS OF Season */
+template <typename Season>
+bool SeparateNext()
+{
+    // a sweep reads ts+1 while it writes ts, and ts=0, which the wrap to
+    // ts=maxTs-1 reads, is written last. So W itself holds exactly what
+    // Wnext would, except when there is only one ts and the update is not in place
+    return Season::Count() == 1 && !inPlace;
+} // end SeparateNext()
+
+
+/* WHETHER OptDec() NEEDS THE PREVIOUS ITERATION'S FITNESS IN A SEPARATE ARRAY */
+inline bool SeparateNext()
+{
+    return SeparateNext<Seasons>();
+} // end SeparateNext()
+
+
+/* ARRAY HOLDING THE FITNESS OF THE NEXT TIME STEP */
+template <typename Real>
+Tensor4<Real> &NextFit(Tensors<Real> &S)
+{
+    return SeparateNext() ? S.Wnext : S.W;
+} // end NextFit()
+
+
+/* ADVISE THE KERNEL ABOUT t ROWS tlo, ..., thi-1 OF SLICE ts (modulo maxTs) OF A BULK TENSOR IN THE SCRATCH FILE */
+template <typename Real>
+void SliceAdvise(Tensor4<Real> &A, int ts, int tlo, int thi, int advice)
+{
+    int t;
+
+    if (arena.fd < 0 || A.empty()) return;
+
+    ts = (ts + maxTs) % maxTs;
+
+    if (blocked) // the rows of a slice are contiguous
+    {
+        if (tlo < thi) ArenaAdvise(A.Row(tlo,ts,0), A.Row(thi-1,ts,0) + (maxD+1)*maxH, advice);
+    }
+    else
+    {
+        for (t=tlo;t<thi;++t)
+        {
+            ArenaAdvise(A.Row(t,ts,0), A.Row(t,ts,0) + (maxD+1)*maxH, advice);
+        }
+    }
+} // end SliceAdvise()
+
+
+/* NUMBER OF ts SLICES OF EACH OF n BULK TENSORS THAT FIT IN THE RESIDENT BUDGET, BUT AT LEAST least */
+template <typename Real>
+int Window(int n, int least)
+{
+    size_t slice,fixed;
+
+    if (arena.fd < 0 || rssBudget == 0) return maxTs;
+
+    // the tables that stay mapped throughout: Wopt, the strategy and a V's worth of rows
+    slice = size_t(maxT)*(maxD+1)*maxH*sizeof(Real);
+    fixed = size_t(maxT)*maxTs*(maxD+1)*(sizeof(Real) + 2*sizeof(int)) + slice;
+
+    if (rssBudget <= fixed) return least;
+
+    return std::max(least, std::min(maxTs, int((rssBudget - fixed) / (n*slice))));
+} // end Window()
+
+
+/* ZERO A TABLE INDEXED [t][..][..], EACH THREAD ITS OWN t ROWS, SO THAT EVERY PAGE IS PLACED ON THE NODE OF THE THREAD THAT WORKS ON IT */
+template <typename T>
+void FirstTouch(Tensor3<T> &A)
+{
+    assert(A.n0 == size_t(maxT));
+
+    if (A.sparse) return; // writing zeros would only fill in the scratch file
+
+    TeamRun([&A](int id) {
+        int tlo,thi;
+
+        TBlock(id, tlo, thi);
+        std::fill(A[tlo][0], A[thi][0], T(0));
+    });
+} // end FirstTouch()
+
+
+/* ZERO A BULK TENSOR, EACH THREAD ITS OWN t ROWS (for either layout) */
+template <typename Real>
+void FirstTouch(Tensor4<Real> &A)
+{
+    if (A.sparse) return;
+
+    TeamRun([&A](int id) {
+        int t,ts,d,tlo,thi;
+
+        TBlock(id, tlo, thi);
+
+        for (ts=0;ts<maxTs;++ts)
+        {
+            for (t=tlo;t<thi;++t)
+            {
+                for (d=0;d<=maxD;++d)
+                {
+                    std::fill(A.Row(t,ts,d), A.Row(t,ts,d) + maxH, Real(0.0));
+                }
+            }
+
+            // the zeros are in the scratch file now, so under a budget the pages can go
+            if (Window<Real>(1, 1) < maxTs) SliceAdvise(A, ts, tlo, thi, MADV_DONTNEED);
+        }
+    });
+} // end FirstTouch()
+
+
+
+/* ALLOCATE FITNESS ARRAYS */
+template <typename Real>
+void AllocFit(Tensors<Real> &S)
+{
+    S.Wopt.Alloc(maxT, maxTs, maxD+1);
+    S.W.Alloc(blocked);
+    S.V.Alloc(maxT, maxD+1, maxH);
+
+    FirstTouch(S.Wopt);
+    FirstTouch(S.W);
+    FirstTouch(S.V);
+
+    if (SeparateNext())
+    {
+        S.Wnext.Alloc(blocked);
+        FirstTouch(S.Wnext);
+    }
+} // end AllocFit()
+
+
+/* ALLOCATE FREQUENCY ARRAYS */
+template <typename Real>
+void AllocFreq(Tensors<Real> &S)
+{
+    S.F.Alloc(blocked);
+    S.Fnext.Alloc(blocked);
+
+    FirstTouch(S.F);
+    FirstTouch(S.Fnext);
+} // end AllocFreq()
+
+
+/* ARENA BYTES TAKEN BY AllocFit() */
+template <typename Real>
+size_t FitBytes()
+{
+    return RoundUp(Tensor3<Real>::Bytes(maxT, maxTs, maxD+1), cacheLine)
+        + RoundUp(Tensor4<Real>::Bytes(), cacheLine)
+        + RoundUp(Tensor3<Real>::Bytes(maxT, maxD+1, maxH), cacheLine)
+        + (SeparateNext() ? RoundUp(Tensor4<Real>::Bytes(), cacheLine) : 0);
+} // end FitBytes()
+
+
+/* ARENA BYTES TAKEN BY AllocFreq() */
+template <typename Real>
+size_t FreqBytes()
+{
+    return 2 * RoundUp(Tensor4<Real>::Bytes(), cacheLine);
+} // end FreqBytes()
+
+
+/* ARENA BYTES NEEDED FOR ONE PARAMETER POINT WITH THE CURRENT SETTINGS */
+inline size_t Footprint()
+{
+    size_t strat,fit,freq;
+
+    // a finite horizon only takes two slices of W, one age each
+    if (horizon > 0) return 2*RoundUp(Tensor3<double>::Bytes(maxT, maxD+1, maxH), cacheLine);
+
+    // strategy, plus its single precision copy for the comparison
+    strat = RoundUp(Tensor3<int>::Bytes(maxT, maxTs, maxD+1), cacheLine) * (precision == "mixed" ? 2 : 1);
+
+    // the single precision arrays of --precision=mixed live in the double
+    // precision ones (see Overlay()); the fitness arrays are handed back
+    // before the forward calculation
+    fit = FitBytes<double>();
+    freq = runFwdCalc ? FreqBytes<double>() : 0;
+
+    // edge rows of the threads in the forward calculation
+    if (runFwdCalc && team.n > 1 && team.group == NULL)
+    {
+        freq += RoundUp(Tensor3<double>::Bytes(2*team.n, maxTs*(maxD+1), maxH), cacheLine);
+    }
+
+    return strat + (keepFit ? fit + freq : std::max(fit, freq));
+} // end Footprint()
+
+
+/* LAY A SINGLE PRECISION TABLE OVER THE UPPER HALF OF A DOUBLE PRECISION ONE */
+inline void Overlay(Tensor3<double> &A, Tensor3<float> &B)
+{
+    B.n0 = A.n0;
+    B.s0 = A.s0;
+    B.s1 = A.s1;
+    B.sparse = A.sparse;
+    B.data = A.data == NULL ? NULL : (float *)A.data + A.size();
+} // end Overlay()
+
+
+/* LAY A SINGLE PRECISION BULK TENSOR OVER THE UPPER HALF OF A DOUBLE PRECISION ONE, WITH THE SAME LAYOUT */
+inline void Overlay(Tensor4<double> &A, Tensor4<float> &B)
+{
+    B.sT = A.sT;
+    B.sTs = A.sTs;
+    B.sD = A.sD;
+    B.sparse = A.sparse;
+    B.data = A.empty() ? NULL : (float *)A.data + Tensor4<double>::Bytes()/sizeof(double);
+} // end Overlay()
+
+
+/* LAY THE SINGLE PRECISION ARRAYS OF Sf OVER THE ALLOCATED ARRAYS OF S, FOR --precision=mixed; S has
+   been zeroed, and zero in double precision is zero in single, so Sf starts out zeroed as well */
+inline void Overlay(Tensors<double> &S, Tensors<float> &Sf)
+{
+    Overlay(S.Wopt, Sf.Wopt);
+    Overlay(S.W, Sf.W);
+    Overlay(S.V, Sf.V);
+    Overlay(S.Wnext, Sf.Wnext);
+    Overlay(S.F, Sf.F);
+    Overlay(S.Fnext, Sf.Fnext);
+} // end Overlay()
+
+
+/* WIDEN THE n FLOATS IN THE UPPER HALF OF THE n DOUBLES AT data INTO THOSE DOUBLES */
+inline void Widen(double *data, size_t n)
+{
+    size_t lo,hi;
+    const float *half;
+
+    if (data == NULL) return;
+
+    half = (const float *)data + n;
+
+    // in rounds: the doubles below (n + lo)/2 only overwrite floats below
+    // lo, which earlier rounds have read, so the threads can share a round
+    for (lo=0;lo<n;lo=hi)
+    {
+        hi = std::max(lo + 1, (n + lo)/2);
+
+        TeamRun([data, half, lo, hi](int id) {
+            size_t k,k0,k1;
+
+            k0 = lo + (hi - lo)*id/team.n;
+            k1 = lo + (hi - lo)*(id + 1)/team.n;
+
+            for (k=k0;k<k1;++k) data[k] = half[k];
+        });
+    }
+} // end Widen()
+
+
+/* PROMOTE THE SINGLE PRECISION ARRAYS OF Sf, LAID OVER THOSE OF S BY Overlay(), TO DOUBLE PRECISION IN PLACE,
+   so that the two precisions never take more memory than double precision alone */
+inline void Promote(Tensors<float> &Sf, Tensors<double> &S)
+{
+    if (Sf.Wopt.data != NULL) Widen(S.Wopt.data, S.Wopt.size());
+    if (!Sf.W.empty()) Widen(S.W.data, Tensor4<double>::Bytes()/sizeof(double));
+    if (Sf.V.data != NULL) Widen(S.V.data, S.V.size());
+    if (!Sf.Wnext.empty()) Widen(S.Wnext.data, Tensor4<double>::Bytes()/sizeof(double));
+    if (!Sf.F.empty()) Widen(S.F.data, Tensor4<double>::Bytes()/sizeof(double));
+    if (!Sf.Fnext.empty()) Widen(S.Fnext.data, Tensor4<double>::Bytes()/sizeof(double));
+} // end Promote()
+
+
+/* SPECIFY FINAL FITNESS */
+template <typename Real>
+void FinalFit(Tensors<Real> &S)
+{
+  // each thread its own rows, so that no process of a group overwrites rows another has started on
+  TeamRun([&S](int id) {
+    int t,d,h,tlo,thi;
+
+    TBlock(id, tlo, thi);
+
+    for (t=std::max(1,tlo);t<thi;++t) // note that Wnext is undefined for t=0 because t=1 if predator has just attacked
+    {
+        for (d=0;d<=maxD;++d)
+        {
+            for (h=0;h<maxH;++h)
+            {
+               S.V[t][d][h] =  NextFit(S)(t,maxTs - 1,d,h) = repro[maxTs - 1][d];
+            }
+        }
+    }
+  });
+} // end FinalFit()
+
+
+/* START FROM THE FITNESS OF warm, A SOLUTION ON THE SAME GRID AND LAYOUT, RATHER THAN FROM THE FINAL FITNESS */
+template <typename Real>
+void WarmFit(Tensors<Real> &S, Tensors<Real> &warm)
+{
+  // the sweeps iterate all of W, so a nearby fixed point is as good a start as FinalFit()
+  TeamRun([&S, &warm](int id) {
+    int t,ts,d,tlo,thi;
+
+    TBlock(id, tlo, thi);
+
+    for (t=tlo;t<thi;++t)
+    {
+        for (ts=0;ts<maxTs;++ts)
+        {
+            for (d=0;d<=maxD;++d)
+            {
+                std::copy(warm.W.Row(t,ts,d), warm.W.Row(t,ts,d) + maxH, S.W.Row(t,ts,d));
+
+                if (SeparateNext())
+                {
+                    std::copy(warm.Wnext.Row(t,ts,d), warm.Wnext.Row(t,ts,d) + maxH, S.Wnext.Row(t,ts,d));
+                }
+            }
+        }
+    }
+
+    std::copy(warm.V[tlo][0], warm.V[thi][0], S.V[tlo][0]);
+  });
+} // end WarmFit()
+
+
+/* SIZE THE TABLES TO THE GRID */
+inline void AllocTables()
+{
+  pPred.assign(maxT, 0.0);
+  pKilled.assign(maxH, 0.0);
+  mu.assign(maxD+1, 0.0);
+  dnew.Resize(maxD+1, maxH);
+  dlow.Resize(maxD+1, maxH);
+  dhigh.Resize(maxD+1, maxH);
+  dfrac.Resize(maxD+1, maxH);
+  repro.Resize(maxTs, maxD+1);
+  hLow.assign(maxD+1, 0);
+} // end AllocTables()
+
+
+
+/* CALCULATE PROBABILITY THAT PREDATOR IS PRESENT */
+inline void PredProb()
+{
+  int t;
+
+  pPred[1] = 1.0 - pLeave; // if predator attacked in last time step
+
+  for (t=2;t<maxT;++t) // if predator did NOT attack in last time step
+  {
+//      Pr(predator present at time t | predator did not attack at time t-1)
+//      = Pr (predator did not attack at time t-1 | predator present at time t) * 
+//              Pr( predator present at time t)  / Pr(predator did not attack at time t-1)
+    pPred[t] = (pPred[t-1]*(1.0-pAttack)*(1.0-pLeave)+(1.0-pPred[t-1])*pArrive) / (1.0 - pPred[t-1]*pAttack);
+  }
+} // end PredProb
+
+
+
+// Components of the model: each functional form is a policy type whose
+// Eval() gives one entry of its table, constexpr where the form allows it.
+// The tables are built from them once a point, so the sweeps only ever read
+// tables, and a variant of the model is a Form of other components passed to
+// Setup(). A component also says what it knows of its shape, which the
+// search for the optimal h can use: see HormoneFloor()
+
+// pKilled = 1 - (h/maxH)^alpha
+struct PowerPredation
+{
+    static constexpr bool falling = true; // pKilled never rises with h, as alpha >= 0
+
+    static double Eval(int h, int hmax, double a) { return 1.0 - pow(double(h)/double(hmax),a); }
+};
+
+// mu = mu0 + Kmort d, at most 1
+struct LinearMortality
+{
+    static constexpr double Eval(int d, double k) { return std::min(1.0,mu0 + k*double(d)); }
+};
+
+// new damage d + 4(h/maxH)^2 - 1, between 0 and maxD
+struct QuadraticDamage
+{
+    static constexpr bool rising = true; // the new damage level never falls with h
+
+    static constexpr double Eval(int d, int h, int dmax, int hmax)
+    {
+        return std::max(0.0,std::min(double(dmax),double(d) + 4.0*(double(h)/double(hmax))*(double(h)/double(hmax))-1.0));
+    }
+};
+
+// reproductive output 1 - Kfec d, at least 0, at the end of a season
+struct LinearFecundity
+{
+    static constexpr double Eval(int d, double k) { return std::max(0.0, 1.0 - k*double(d)); }
+};
+
+// a model: one component of each kind
+template <typename Predation, typename Mortality, typename Damage, typename Fecundity>
+struct Form
+{
+    typedef Predation Pred;
+    typedef Mortality Mort;
+    typedef Damage Dam;
+    typedef Fecundity Fec;
+};
+
+typedef Form<PowerPredation, LinearMortality, QuadraticDamage, LinearFecundity> StandardForm;
+
+static_assert(LinearMortality::Eval(0, 0.01) == mu0, "a component can be evaluated at compile time");
+
+
+/* CALCULATE PROBABILITY OF BEING KILLED BY AN ATTACKING PREDATOR */
+template <typename F>
+void Predation()
+{
+  int h;
+
+  for (h=0;h<maxH;++h)
+  {
+    pKilled[h] = F::Pred::Eval(h, maxH, alpha);
+  }
+} // end Predation()
+
+
+/* CALCULATE BACKGROUND MORTALITY */
+template <typename F>
+void Mortality()
+{
+  int d;
+
+  for (d=0;d<=maxD;++d)
+  {
+    mu[d] = F::Mort::Eval(d, Kmort);
+  }
+} // end Mortality()
+
+
+
+/* CALCULATE DAMAGE */
+template <typename F>
+void Damage()
+{
+  int d,h;
+
+  for (d=0;d<=maxD;++d)
+  {
+    for (h=0;h<maxH;++h)
+    {
+      dnew[d][h] = F::Dam::Eval(d, h, maxD, maxH);
+      dlow[d][h] = floor(dnew[d][h]); // for linear interpolation
+      dhigh[d][h] = ceil(dnew[d][h]); // for linear interpolation
+      dfrac[d][h] = dnew[d][h]-double(dlow[d][h]); // for linear interpolation
+    }
+  }
+} // void Damage()
+
+
+/* CALCULATE PROBABILITY OF REPRODUCING */
+template <typename F>
+void Reproduction()
+{
+  int d, ts;
+
+  for (ts = 0; ts < maxTs; ++ts)
+  { 
+    for (d=0;d<=maxD;++d)
+    {
+        repro[ts][d] = ts == maxTs - 1 ? F::Fec::Eval(d, Kfec) : 0.0;
+
+        if (maxTs - 1 && !quiet)
+        {
+            std::cout << repro[ts][d] << std::endl;
+        }
+    }
+  }
+} // end Reproduction()
+
+
+/* FIND THE LOWEST HORMONE LEVEL TO SEARCH FOR EACH DAMAGE LEVEL: 0, UNLESS --search=pruned */
+template <typename F>
+void HormoneFloor()
+{
+  int d,h;
+
+  // h enters the expected fitness only through pKilled and the new damage
+  // level. Where damage rises with h, the levels that leave no damage at
+  // all form the first segment; within it only pKilled changes, and if that
+  // falls with h, the last level of the segment is the best of it. The
+  // search never settles on the end of its bracket, and that level is
+  // often the optimum, so the bracket opens one level below it. A narrower
+  // bracket probes other levels, and may settle on another fixed point, so
+  // the full range stays the default
+  for (d=0;d<=maxD;++d)
+  {
+    h = 0;
+
+    if (search == "pruned" && F::Pred::falling && F::Dam::rising)
+    {
+      while (h+1 < maxH && dnew[d][h+1] == 0.0) ++h;
+    }
+
+    hLow[d] = std::max(0, h-1);
+  }
+} // end HormoneFloor()
+
+
+
+/* ORDER IN WHICH A SWEEP VISITS THE INDICES lo, ..., hi-1 */
+inline std::vector<int> SweepOrder(const std::string &order, int lo, int hi)
+{
+    int k;
+    std::vector<int> idx;
+
+    if (order == "descending")
+    {
+        for (k=hi-1;k>=lo;--k) idx.push_back(k);
+    }
+    else if (order == "red-black") // every other index first, then the ones in between
+    {
+        for (k=lo;k<hi;k+=2) idx.push_back(k);
+        for (k=lo+1;k<hi;k+=2) idx.push_back(k);
+    }
+    else
+    {
+        for (k=lo;k<hi;++k) idx.push_back(k);
+    }
+
+    return idx;
+} // end SweepOrder()
+
+
+
+/* FIND THE h OF THE LARGEST FITNESS IN Wrow, FROM h = LHS ON, BY GOLDEN SECTION SEARCH; its fitness goes to fit */
+template <typename Real>
+inline int SearchRow(const Real *Wrow, int LHS, Real &fit)
+{
+      int RHS,x1,x2;
+      Real fitness_x1,fitness_x2;
+
+      // GOLDEN SECTION SEARCH
+      // following https://medium.datadriveninvestor.com/golden-section-search-method-peak-index-in-a-mountain-array-leetcode-852-a00f53ed4076
+      RHS = maxH;
+      x1 = RHS - (round((double(RHS)-double(LHS))*phi_inv));
+      x2 = LHS + (round((double(RHS)-double(LHS))*phi_inv));
+      fitness_x1 = Wrow[x1];
+
+      while (x1<x2)
+      {
+        fitness_x1 = Wrow[x1]; // fitness as a function of h=x1
+        fitness_x2 = Wrow[x2]; // fitness as a function of h=x2
+
+        if (fitness_x1 < fitness_x2)
+        {
+            LHS = x1;
+            x1 = x2;
+            x2 = RHS - (round((double(RHS)-double(x1))*phi_inv));
+        }
+        else
+        {
+            RHS = x2;
+            x2 = x1;
+            x1 = LHS + (round((double(x2)-double(LHS))*phi_inv));
+        }
+      }
+
+      fit = fitness_x1;
+
+      return x1;
+} // end SearchRow()
+
+
+/* EXACT ARGMAX OF Wrow OVER ALL h, THE LOWEST OF A TIE, FOR --search=exhaustive */
+template <typename Real>
+inline int ScanRow(const Real *Wrow, Real &fit)
+{
+      int h,best;
+
+      best = 0;
+
+      for (h=1;h<maxH;++h)
+      {
+        if (Wrow[h] > Wrow[best]) best = h;
+      }
+
+      fit = Wrow[best];
+
+      return best;
+} // end ScanRow()
+
+
+/* CALCULATE OPTIMAL DECISION h GIVEN CURRENT t, ts AND d FOR ALL d */
+template <typename Real, typename Season>
+void OptDecRow(Tensors<Real> &S, int t, int ts)
+{
+    int d,k;
+    const Real *Wrow;
+    Tensor4<Real> &Wn = NextFit(S);
+    const bool scan = search == "exhaustive";
+
+    for (k=0;k<(int)dOrder.size();++k)
+    {
+      d = dOrder[k];
+
+      // range of values of ts +1: 
+      //    maxTs - 2 + 1 = maxTs - 1 (i.e., end of array)
+      //    0 + 1 = 1 (i.e., one off start of array
+      //    Wnext[ts = 0] will not be accessed
+      Wrow = Wn.Row(std::min(maxT-1,t+1),Season::Next(ts),d);
+
+      // ts ranges here from MaxTs - 2 to 0
+      // i.e., there are no hormone, Wopt values here for MaxTs - 1
+      // optimal hormone level, and fitness of optimal decision
+      hormone[t][ts][d] = scan ? ScanRow(Wrow, S.Wopt[t][ts][d]) : SearchRow(Wrow, hLow[d], S.Wopt[t][ts][d]);
+    } // end for d
+} // end OptDecRow()
+
+
+
+/* EXPECTED FITNESS Wrow AS A FUNCTION OF h AT DAMAGE d, WITH pAtt THE CHANCE OF AN ATTACK, r THE REPRODUCTIVE OUTPUT AND Wopt0 AND Woptt THE FITNESS UNDER THE OPTIMAL DECISION AFTER AN ATTACK AND WITHOUT ONE */
+template <typename Real>
+inline void FitValues(Real *Wrow, int d, Real pAtt, Real r, const Real *Wopt0, const Real *Woptt)
+{
+    int h,d1,d2;
+    Real ddec,surv;
+
+    surv = Real(1.0)-Real(mu[d]);
+
+    for (h=0;h<maxH;++h)
+    {
+        d1=dlow[d][h]; // for linear interpolation
+        d2=dhigh[d][h]; // for linear interpolation
+        ddec=dfrac[d][h]; // for linear interpolation
+
+        Wrow[h] = pAtt*(Real(1.0)-Real(pKilled[h]))*surv*(r + 
+                (Real(1.0)-ddec)*Wopt0[d1]+ddec*Wopt0[d2]) // survive attack
+                    + (Real(1.0)-pAtt)*surv*(r +
+                            (Real(1.0)-ddec)*Woptt[d1]+ddec*Woptt[d2]); // no attack
+    } // end for h
+} // end FitValues()
+
+
+/* CALCULATE EXPECTED FITNESS W AS A FUNCTION OF h AND d FOR GIVEN t AND ts, BEFORE PREDATOR DOES/DOESN'T ATTACK */
+template <typename Real, typename Season>
+void FitRow(Tensors<Real> &S, int t, int ts)
+{
+    int d,k;
+    Real pAtt;
+    Real *Wrow;
+    const Real *Wopt0 = &S.Wopt[0][ts][0];
+    const Real *Woptt = &S.Wopt[t][ts][0];
+
+    // all arithmetic is done in Real, so that single precision
+    // fills twice as many values per vector register
+    pAtt = pPred[t]*pAttack;
+
+    for (k=0;k<(int)dOrder.size();++k)
+    {
+        d = dOrder[k];
+        Wrow = S.W.Row(t,ts,d);
+
+        FitValues(Wrow, d, pAtt, Real(repro[ts][d]), Wopt0, Woptt);
+
+        if (SeparateNext<Season>())
+        {
+            std::copy(Wrow, Wrow + maxH, S.Wnext.Row(t,ts,d));
+        }
+    } // end for d
+} // end FitRow()
+
+
+
+/* CALCULATE OPTIMAL DECISION FOR THE t ROWS OF THREAD id, ONE OF THE n THREADS SHARING THE SWEEP */
+template <typename Real, typename Season>
+void OptDecRows(Tensors<Real> &S, int id, int n)
+{
+    int ts,k,k0,k1,tile,tlo,thi,parity,window;
+    std::vector<int> rows; // rows of this thread, in sweep order
+
+    if (n == 1)
+    {
+        tlo = 1;
+        thi = maxT;
+    }
+    else
+    {
+        TBlock(id, tlo, thi);
+    }
+
+    for (k=0;k<(int)tOrder.size();++k)
+    {
+        if (tOrder[k] >= tlo && tOrder[k] < thi) rows.push_back(tOrder[k]);
+    }
+
+    // rows of a tile are searched and filled before the next tile, so that
+    // their decisions are still in cache. In place with a single ts a row
+    // reads the row after it, so then tiles are single rows
+    tile = inPlace && Season::Count() == 1 ? 1 : tileT;
+
+    // slices of W that stay mapped when the arena is a scratch file
+    window = Window<Real>(1, 2);
+
+    // go from maxTs down to 0
+    // start from maxTs - 2, as we need to reach back
+    // to array positions given by ts + 1
+    for (ts = Season::Count() - 1; ts >= 0; --ts)
+    {
+        // t=0 first (N.B. t=0 if survived attack), as every W in this ts needs Wopt[0].
+        // The barrier after it also keeps every thread from reading slice ts+1
+        // before the others have finished writing it
+        if (id == 0) OptDecRow<Real, Season>(S, 0, ts);
+        if (n > 1) TeamSync();
+
+        // out of core: fetch the slice written next while this one is worked on
+        SliceAdvise(S.W, ts - 1, tlo, thi, MADV_WILLNEED);
+
+        if (SeparateNext<Season>())
+        {
+            // calculate optimal decision h given current t, ts and d
+            // where h in t, ts, and d is unimodal
+            for (k=0;k<(int)rows.size();++k)
+            {
+                OptDecRow<Real, Season>(S, rows[k], ts);
+            }
+
+            // FitRow() copies into the Wnext rows the other threads are still searching
+            if (n > 1) TeamSync();
+
+            // calculate expected fitness W as a function of t, h and d, before predator does/doesn't attack
+            // later on we will then set Wnext = W and see for which hormone level fitness is max
+            for (k=0;k<(int)rows.size();++k) // note that W is undefined for t=0 because t=1 if predator has just attacked
+            {
+                FitRow<Real, Season>(S, rows[k], ts);
+            }
+        }
+        else if (inPlace && Season::Count() == 1 && n > 1)
+        {
+            // red-black in place: odd rows only read even ones and vice versa,
+            // so the threads only need to meet between the two colours
+            for (parity = 1; parity >= 0; --parity)
+            {
+                for (k=0;k<(int)rows.size();++k)
+                {
+                    if (rows[k] % 2 != parity) continue;
+
+                    OptDecRow<Real, Season>(S, rows[k], ts);
+                    FitRow<Real, Season>(S, rows[k], ts);
+                }
+
+                if (parity == 1) TeamSync();
+            }
+        }
+        else
+        {
+            // optimal decision and expected fitness tile by tile; the sweep reads
+            // slice ts+1 and writes slice ts, so the tiles do not interact
+            for (k0=0;k0<(int)rows.size();k0+=tile)
+            {
+                k1 = std::min((int)rows.size(), k0 + tile);
+
+                for (k=k0;k<k1;++k)
+                {
+                    OptDecRow<Real, Season>(S, rows[k], ts);
+                }
+
+                for (k=k0;k<k1;++k)
+                {
+                    FitRow<Real, Season>(S, rows[k], ts);
+                }
+            }
+        }
+
+        // and let go of the slice that has left the window
+        if (window < Season::Count()) SliceAdvise(S.W, ts + window, tlo, thi, MADV_DONTNEED);
+    } // end for ts
+} // end OptDecRows()
+
+
+
+/* CALCULATE OPTIMAL DECISION FOR EACH t, WITH THE SEASONS OF Season */
+template <typename Real, typename Season>
+void OptDecSeason(Tensors<Real> &S)
+{
+    // in place with a single ts a row reads its neighbours in the same sweep,
+    // so the threads can only share it if the sweep is red-black
+    if (team.n > 1 && (!(inPlace && Season::Count() == 1) || tRedBlack))
+    {
+        TeamRun([&S](int id) { OptDecRows<Real, Season>(S, id, team.n); });
+    }
+    else if (team.group != NULL)
+    {
+        // the other processes wait for the first to do the whole sweep
+        TeamRun([&S](int id) { if (id == 0) OptDecRows<Real, Season>(S, 0, 1); });
+    }
+    else
+    {
+        OptDecRows<Real, Season>(S, 0, 1);
+    }
+} // end void OptDecSeason()
+
+
+
+/* CALCULATE OPTIMAL DECISION FOR EACH t */
+template <typename Real>
+void OptDec(Tensors<Real> &S)
+{
+    // decided once a sweep, so that the survival-only model runs the
+    // sweep with no trace of the seasons
+    if (maxTs == 1) OptDecSeason<Real, OneSeason>(S); else OptDecSeason<Real, Seasons>(S);
+} // end void OptDec()
+
+
+
+/* OVERWRITE FITNESS ARRAY FROM PREVIOUS ITERATION FOR THE t ROWS OF THREAD id; returns their fitness difference, and the largest one in maxdiff */
+template <typename Real>
+double ReplaceFitRows(Tensors<Real> &S, int id, double &maxdiff)
+{
+    int t,h,d,tlo,thi;
+    double fitdiff; // accumulated in double whatever the precision of the arrays
+    const Real *Wrow;
+    Real *Vrow;
+
+    TBlock(id, tlo, thi);
+
+    fitdiff = 0.0;
+    maxdiff = 0.0;
+
+    for (t=std::max(1,tlo);t<thi;t++)
+    {
+        for (d=0;d<=maxD;++d)
+        {
+            Wrow = S.W.Row(t,0,d);
+            Vrow = &S.V[t][d][0];
+
+            for (h=0;h<maxH;++h)
+            {
+                fitdiff = fitdiff + fabs(double(Vrow[h])-double(Wrow[h]));
+                maxdiff = std::max(maxdiff, fabs(double(Vrow[h])-double(Wrow[h])));
+
+                Vrow[h] = Wrow[h];
+            }
+
+            if (SeparateNext())
+            {
+                std::copy(Wrow, Wrow + maxH, S.Wnext.Row(t,maxTs - 1,d));
+            }
+        }
+    }
+
+    // V is not needed again until the next ReplaceFit()
+    if (Window<Real>(1, 2) < maxTs) ArenaAdvise(S.V[tlo][0], S.V[thi][0], MADV_DONTNEED);
+
+    return fitdiff;
+} // end ReplaceFitRows()
+
+
+
+/* OVERWRITE FITNESS ARRAY FROM PREVIOUS ITERATION */
+template <typename Real>
+void ReplaceFit(Tensors<Real> &S)
+{
+    int id;
+    double *fitdiff = team.partial; // shared by the processes of a group, so that all of them see the same sum
+    double *maxdiff = team.partial + team.n;
+
+    TeamRun([&S, fitdiff, maxdiff](int id) { fitdiff[id] = ReplaceFitRows(S, id, maxdiff[id]); });
+
+    // summed in thread order, so that a given number of threads always gives the same result
+    totfitdiff = fitdiff[0];
+    maxfitdiff = maxdiff[0];
+
+    for (id=1;id<team.n;++id)
+    {
+        totfitdiff += fitdiff[id];
+        maxfitdiff = std::max(maxfitdiff, maxdiff[id]);
+    }
+} // void ReplaceFit()
+
+
+
+/* PRINT OUT OPTIMAL STRATEGY */
+inline void PrintStrat()
+{
+  int t,d,ts;
+
+  outputfile << "t" << "\t" << "d" << "\t" << (seasonal ? "ts\t" : "") << "hormone" << std::endl;
+
+  // with --pack the rows go to stratL*.sdp instead
+  for (t=0;t<maxT && !packStrat;++t)
+  {
+      for (ts = 0; ts < maxTs; ++ts)
+      {
+        for (d=0;d<=maxD;++d)
+        {
+            for (ts=0;ts<maxTs;++ts)
+            {
+              outputfile << t << "\t" << d << "\t";
+              if (seasonal) outputfile << ts << "\t";
+              outputfile << hormone[t][ts][d] << std::endl;
+            }
+        }
+      }
+  }
+
+  outputfile << std::endl;
+  outputfile << "nIterations" << "\t" << i << std::endl;
+
+  if (stopRule == "policy")
+  {
+      outputfile << "stoppedBy" << "\t" << stoppedBy << std::endl;
+      outputfile << "fitBound" << "\t" << fitBound << std::endl;
+  }
+
+  outputfile << std::endl;
+}
+
+
+
+
+/* WRITE PARAMETER SETTINGS TO OUTPUT FILE */
+inline void PrintParams()
+{
+  outputfile << std::endl << "PARAMETER VALUES" << std::endl
+       << "pLeave: " << "\t" << pLeave << std::endl
+       << "pArrive: " << "\t" << pArrive << std::endl
+       << "pAttack: " << "\t" << pAttack << std::endl
+       << "alpha: " << "\t" << alpha << std::endl
+//       << "beta: " << "\t" << beta << std::endl
+       << "mu0: " << "\t" << mu0 << std::endl
+       << "Kmort: " << "\t" << Kmort << std::endl
+       << "Kfec: " << "\t" << Kfec << std::endl
+       << "maxI: " << "\t" << maxI << std::endl
+       << "maxT: " << "\t" << maxT << std::endl;
+
+  // the plotting script takes a file with maxTs for one of the seasonal model
+  if (seasonal) outputfile << "maxTs: " << "\t" << maxTs << std::endl;
+
+  outputfile << "maxD: " << "\t" << maxD << std::endl
+       << "maxH: " << "\t" << maxH << std::endl;
+}
+
+
+
+/* WRITE WHY THE CURRENT POINT WAS GIVEN UP, ONE FIELD A LINE */
+inline void PrintError()
+{
+  ///////////////////////////////////////////////////////
+  outfile.str("");
+  outfile << "errorL";
+  outfile << std::fixed << pLeave;
+  outfile << "A";
+  outfile << std::fixed << pArrive;
+  outfile << "Kmort";
+  outfile << std::fixed << Kmort;
+  outfile << "Kfec";
+  outfile << std::fixed << Kfec;
+  outfile << ".txt";
+  std::string errorfilename = outfile.str();
+  outputfile.open(errorfilename.c_str());
+  ///////////////////////////////////////////////////////
+
+  outputfile << "error" << "\t" << failKind << std::endl
+       << "detail" << "\t" << failDetail << std::endl
+       << "iteration" << "\t" << (failKind == "invalid" ? 0 : i) << std::endl;
+
+  if (failKind != "invalid")
+  {
+      outputfile << "totfitdiff" << "\t" << totfitdiff << std::endl
+           << "maxfitdiff" << "\t" << maxfitdiff << std::endl;
+  }
+
+  PrintParams();
+  outputfile.close();
+} // end PrintError()
+
+
+
+/* INITIALISE FREQUENCIES FOR THE FORWARD CALCULATION */
+template <typename Real>
+void InitFreq(Tensors<Real> &S)
+{
+  // F and Fnext have been zeroed by AllocFreq(), by the threads that own their rows
+  S.F(std::min(50,maxT-1),0,0,0) = 1.0; // initialise all individuals with zero damage, zero hormone and 50 time steps since last attack, during the first reproductive bout
+} // end InitFreq()
+
+
+
+// per-thread results of one step of the forward calculation
+struct FwdPart
+{
+    double pred;   // deaths from predation
+    double damage; // deaths from damage
+    double diff;   // largest frequency difference
+    Table2<double> byDT; // frequencies summed over ts and h
+    Table2<double> byDH; // frequencies summed over t and ts
+};
+
+
+/* ONE TIME STEP OF THE FORWARD CALCULATION FOR THE t ROWS OF THREAD id */
+template <typename Real>
+void FwdStep(Tensors<Real> &S, Tensor3<Real> &edge, std::vector<FwdPart> &part, int id)
+{
+  int t,ts,d,h,d1,d2,h1,h2,tlo,thi,tnext,k,window;
+  Real ddec,f;
+  Real *toOne,*toNext,*row,*from;
+  double pred,damage,norm,maxfreqdiff,rowsum;
+
+  TBlock(id, tlo, thi);
+  tlo = std::max(1, tlo); // note that F is undefined for t=0 because t=1 if predator has just attacked
+
+  // individuals never change ts here, so the step goes slice by slice, and
+  // out of core only a window of the slices of F and Fnext stays mapped
+  window = Window<Real>(2, 1);
+
+  pred = 0.0; // death rates are accumulated in double whatever the precision of F
+  damage = 0.0;
+
+  for(ts=0; ts<maxTs;++ts)
+  { 
+      SliceAdvise(S.F, ts + 1, tlo, thi, MADV_WILLNEED);
+      SliceAdvise(S.Fnext, ts + 1, tlo, thi, MADV_WILLNEED);
+
+      // survivors of an attack go to t=1, which thread 0 owns, the others to
+      // t+1, which the next thread owns for the last row of a block. What goes
+      // to another thread's rows is collected in this thread's edge rows
+      // (laid out like one t row of Fnext) and added by the owner below
+      toOne = id == 0 ? S.Fnext.Row(1,ts,0) : edge[2*id][ts*(maxD+1)];
+
+      for (t=tlo;t<thi;++t)
+      {
+        tnext = std::min(maxT-1,t+1);
+        toNext = tnext < thi ? S.Fnext.Row(tnext,ts,0) : edge[2*id+1][ts*(maxD+1)];
+
+        for (d=0;d<=maxD;++d)
+        {
+          for (h=0;h<maxH;++h)
+          {
+            d1=dlow[d][h]; // for linear interpolation
+            d2=dhigh[d][h]; // for linear interpolation
+            ddec=dfrac[d][h]; // for linear interpolation
+            f=S.F(t,ts,d,h);
+
+            // attack
+            h1=hormone[0][ts][d1];
+            toOne[d1*maxH+h1] += f*Real(pPred[t])*Real(pAttack)*(Real(1.0)-Real(pKilled[h]))*(Real(1.0)-Real(mu[d]))*(Real(1.0)-ddec);
+            h2=hormone[0][ts][d2];
+            toOne[d2*maxH+h2] += f*Real(pPred[t])*Real(pAttack)*(Real(1.0)-Real(pKilled[h]))*(Real(1.0)-Real(mu[d]))*ddec;
+            // no attack
+            h1=hormone[tnext][ts][d1];
+            toNext[d1*maxH+h1] += f*(Real(1.0)-Real(pPred[t])*Real(pAttack))*(Real(1.0)-Real(mu[d]))*(Real(1.0)-ddec);
+            h2=hormone[tnext][ts][d2];
+            toNext[d2*maxH+h2] += f*(Real(1.0)-Real(pPred[t])*Real(pAttack))*(Real(1.0)-Real(mu[d]))*ddec;
+            // deaths from predation and damage
+            pred += double(f)*pPred[t]*pAttack*pKilled[h];
+            damage += double(f)*(1.0-pPred[t]*pAttack*pKilled[h])*mu[d];
+          } // end for h
+        } // end for d
+      } // end for t
+
+      if (window < maxTs) SliceAdvise(S.F, ts - window, tlo, thi, MADV_DONTNEED);
+      if (window < maxTs) SliceAdvise(S.Fnext, ts - window, tlo, thi, MADV_DONTNEED);
+  } // end for ts
+
+  part[id].pred = pred;
+  part[id].damage = damage;
+
+  TeamSync();
+
+  // total deaths, summed in thread order by every thread alike
+  pred = part[0].pred;
+  damage = part[0].damage;
+
+  for (k=1;k<team.n;++k)
+  {
+      pred += part[k].pred;
+      damage += part[k].damage;
+  }
+
+  norm = 1.0-pred-damage;
+
+  // add what the other threads sent to this thread's rows
+  for (k=0;k<team.n;++k)
+  {
+      if (k == id || (id != 0 && k != id-1)) continue;
+
+      for (ts = 0; ts < maxTs; ++ts)
+      {
+        row = id == 0 ? S.Fnext.Row(1,ts,0) : S.Fnext.Row(tlo,ts,0);
+        from = id == 0 ? edge[2*k][ts*(maxD+1)] : edge[2*k+1][ts*(maxD+1)];
+
+        for (h=0;h<(maxD+1)*maxH;++h)
+        {
+          row[h] += from[h];
+          from[h] = 0.0;
+        }
+      }
+  }
+
+  // NORMALISE AND OVERWRITE FREQUENCIES, taking the marginals on the way
+  maxfreqdiff = 0.0;
+
+  part[id].byDT.Resize(maxD+1, maxT);
+  part[id].byDH.Resize(maxD+1, maxH);
+
+  Table2<double> &byDT = part[id].byDT;
+  Table2<double> &byDH = part[id].byDH;
+
+  if (id == 0)
+  {
+      S.Fnext(1,0,0,0) = S.Fnext(1,0,0,0)/norm; // normalise
+      maxfreqdiff = fabs(double(S.F(1,0,0,0)) - double(S.Fnext(1,0,0,0)));
+  }
+
+  for (ts = 0; ts < maxTs; ++ts)
+  {
+      for (t=tlo;t<thi;t++)
+      {
+        for (d=0;d<=maxD;d++)
+        {
+          rowsum = 0.0;
+
+          for (h=0;h<maxH;h++)
+          {
+            S.Fnext(t,ts,d,h) = S.Fnext(t,ts,d,h)/norm; // normalise
+            maxfreqdiff = std::max(maxfreqdiff,fabs(double(S.F(t,ts,d,h))-double(S.Fnext(t,ts,d,h)))); // stores largest frequency difference so far
+            S.F(t,ts,d,h) = S.Fnext(t,ts,d,h); // next time step becomes this time step
+            S.Fnext(t,ts,d,h) = 0.0; // wipe next time step
+            byDH[d][h] += double(S.F(t,ts,d,h));
+            rowsum += double(S.F(t,ts,d,h));
+          } // end for h
+
+          byDT[d][t] += rowsum;
+        } // end for d
+      } // end for t
+
+      if (window < maxTs) SliceAdvise(S.F, ts - window, tlo, thi, MADV_DONTNEED);
+      if (window < maxTs) SliceAdvise(S.Fnext, ts - window, tlo, thi, MADV_DONTNEED);
+  } // end for ts
+
+  part[id].diff = maxfreqdiff;
+} // end FwdStep()
+
+
+
+/* ITERATE FREQUENCIES UNTIL THE LARGEST CHANGE IS BELOW ftol; returns the number of iterations */
+template <typename Real>
+int FwdIterate(Tensors<Real> &S, double ftol)
+{
+  int i,k,t,d,h,stalled;
+  double maxfreqdiff,lastfreqdiff;
+  size_t mark;
+  Tensor3<Real> edge; // rows 2k and 2k+1: what thread k sends to t=1 and to the row after its block
+  std::vector<FwdPart> part(team.n);
+
+  mark = arena.used;
+
+  if (team.n > 1)
+  {
+      edge.Alloc(2*team.n, maxTs*(maxD+1), maxH);
+
+      TeamRun([&edge](int id) {
+          std::fill(edge[2*id][0], edge[2*id+2][0], Real(0.0)); // first touched by the thread that fills them
+      });
+  }
+
+  i = 0;
+  stalled = 0;
+
+  maxfreqdiff = 1.0;
+  lastfreqdiff = HUGE_VAL;
+
+  while (maxfreqdiff > ftol)
+  {
+      i++;
+
+      TeamRun([&S, &edge, &part](int id) { FwdStep(S, edge, part, id); });
+
+      predDeaths = part[0].pred;
+      damageDeaths = part[0].damage;
+      maxfreqdiff = part[0].diff;
+      for (k=1;k<team.n;++k)
+      {
+          predDeaths += part[k].pred;
+          damageDeaths += part[k].damage;
+          maxfreqdiff = std::max(maxfreqdiff, part[k].diff);
+      }
+
+      if (i%skip==0 && !quiet)
+      {
+        std::cout << i << "\t" << maxfreqdiff << std::endl; // show fitness difference every 'skip' generations
+      }
+
+      // single precision may never get below ftol, so give up once it stalls
+      stalled = maxfreqdiff < lastfreqdiff ? 0 : stalled + 1;
+      lastfreqdiff = maxfreqdiff;
+
+      if (sizeof(Real) < sizeof(double) && stalled >= floatStall) break;
+  } // end while 
+
+  // marginals of the last step, summed in thread order
+  freqDT = part[0].byDT;
+  freqDH = part[0].byDH;
+
+  for (k=1;k<team.n;++k)
+  {
+      for (d=0;d<=maxD;++d)
+      {
+          for (t=0;t<maxT;++t) freqDT[d][t] += part[k].byDT[d][t];
+          for (h=0;h<maxH;++h) freqDH[d][h] += part[k].byDH[d][h];
+      }
+  }
+
+  damageDist.assign(maxD+1, 0.0);
+  hormoneDist.assign(maxH, 0.0);
+  meanT = 0.0;
+
+  for (d=0;d<=maxD;++d)
+  {
+      for (t=0;t<maxT;++t)
+      {
+          damageDist[d] += freqDT[d][t];
+          meanT += t*freqDT[d][t];
+      }
+
+      for (h=0;h<maxH;++h) hormoneDist[h] += freqDH[d][h];
+  }
+
+  ArenaRelease(mark);
+
+  return i;
+} // end FwdIterate()
+
+
+
+/* WRITE OUT FREQUENCIES OF THE FORWARD CALCULATION */
+template <typename Real>
+void PrintFwd(Tensors<Real> &S)
+{
+  int t,ts,d,h;
+  double meanD,meanH;
+
+  ///////////////////////////////////////////////////////
+  outfile.str("");
+  outfile << "fwdCalcL";
+  outfile << std::fixed << pLeave;
+  outfile << "A";
+  outfile << std::fixed << pArrive;
+  outfile << "Kmort";
+  outfile << std::fixed << Kmort;
+  outfile << "Kfec";
+  outfile << std::fixed << Kfec;
+  outfile << ".txt";
+  std::string fwdCalcfilename = outfile.str();
+  fwdCalcfile.open(fwdCalcfilename.c_str());
+  ///////////////////////////////////////////////////////
+
+  meanD = 0.0;
+  meanH = 0.0;
+
+  for (d=0;d<=maxD;++d) meanD += d*damageDist[d];
+  for (h=0;h<maxH;++h) meanH += h*hormoneDist[h];
+
+  fwdCalcfile << "SUMMARY STATS" << std::endl
+    << "predDeaths: " << "\t" << predDeaths << std::endl
+    << "damageDeaths: " << "\t" << damageDeaths << std::endl
+    << "meanT: " << "\t" << meanT << std::endl
+    << "meanDamage: " << "\t" << meanD << std::endl
+    << "meanHormone: " << "\t" << meanH << std::endl
+    << std::endl;
+
+  // marginals of the stationary distribution
+  fwdCalcfile << "DAMAGE DISTRIBUTION" << std::endl << "damage" << "\t" << "freq" << std::endl;
+
+  for (d=0;d<=maxD;++d)
+  {
+      fwdCalcfile << d << "\t" << damageDist[d] << std::endl;
+  }
+
+  fwdCalcfile << std::endl << "HORMONE DISTRIBUTION" << std::endl << "hormone" << "\t" << "freq" << std::endl;
+
+  for (h=0;h<maxH;++h)
+  {
+      fwdCalcfile << h << "\t" << hormoneDist[h] << std::endl;
+  }
+
+  fwdCalcfile << std::endl;
+
+  // the full distribution only if asked for, as it runs to gigabytes on large grids
+  if (!fwdDump)
+  {
+      fwdCalcfile.close();
+      return;
+  }
+
+  fwdCalcfile << "\t" << "t" << "\t" << (seasonal ? "ts\t" : "") << "damage" << "\t" << "hormone" << "\t" << //"repro" << "\t" <<
+    "freq" << std::endl; // column headings in output file
+
+  for (t=1;t<maxT;++t)
+  {
+      for (ts = 0; ts < maxTs; ++ts)
+      {
+        for (d=0;d<=maxD;++d)
+        {
+          for (h=0;h<maxH;++h)
+          {
+            fwdCalcfile << "\t" << t << "\t";
+            if (seasonal) fwdCalcfile << ts << "\t";
+            fwdCalcfile << d << "\t" << h << "\t" << std::setprecision(4) << S.F(t,ts,d,h) << "\t" << std::endl; // print data
+          }
+        }
+
+        if (Window<Real>(2, 1) < maxTs) SliceAdvise(S.F, ts, t, t+1, MADV_DONTNEED); // printed, so no longer needed in memory
+      }
+  }
+
+  fwdCalcfile.close();
+} // end PrintFwd()
+
+
+
+/* FORWARD CALCULATION TO OBTAIN PER-TIME-STEP MORTALITY FROM STRESSOR VS. DAMAGE; the frequencies end up in S.F */
+inline void Forward(Tensors<double> &S)
+{
+  Tensors<float> Sf;
+
+  AllocFreq(S);
+
+  if (precision == "mixed")
+  {
+      // single precision first, in the upper half of the double precision arrays, polished in double precision
+      Overlay(S, Sf);
+      InitFreq(Sf);
+      FwdIterate(Sf, tol);
+
+      Promote(Sf, S);
+  }
+  else
+  {
+      InitFreq(S);
+  }
+
+  FwdIterate(S, tol);
+} // end Forward()
+
+
+
+/* FORWARD CALCULATION, WRITTEN OUT */
+inline void fwdCalc()
+{
+  Tensors<double> S;
+
+  Forward(S);
+  PrintFwd(S);
+} // end fwdCalc()
+
+
+
+inline const int simColumns = 7; // time, t, ts, damage, hormone, attack, reproduce
+
+/* Simulated series of attacks: rows of simColumns values appended to rows */
+inline void SimLife(std::vector<int> &rows)
+{
+  int time_i,t,d,h,d1,d2;
+  double //r,
+    ddec;
+  bool attack;
+
+    // initialise individual (alive, no damage, no offspring, baseline hormone level) and starting environment (predator)
+    //
+    // three seasons, or the 61 steps the survival-only model has always simulated
+    int time_sim_max = seasonal ? maxTs*3 : 61;
+
+    attack = false;
+    time_i = 0; // time overall
+    t = std::min(50, maxT - 1); // time since attack
+   
+    // time point in between 0 and time_sim_max 
+    // at which reproduction takes place
+    int treproduce = 40;
+
+    // time since last reproductive event
+    // add +1 as we need to have ts == Tsmax - 1
+    // 1 timestep before treproduce and we start to count
+    // time from 0
+    // (taken modulo maxTs, as it is negative whenever treproduce >= maxTs)
+    int ts = ((maxTs - 1 - treproduce) % maxTs + maxTs) % maxTs;
+
+    int reproduce = 0;
+
+    d = 0;
+    //    r = 0.0;
+    h = hormone[t][ts][d];
+
+    for(time_i = 0; time_i < time_sim_max; ++time_i)
+    {
+      if (time_i > 16 && time_i < 33) // predator attacks
+      {
+        t = 0;
+        attack = true;
+      }
+      else
+      {
+        t++;
+        attack = false;
+      }
+
+      if (t >= maxT -1)
+      {
+          t = maxT - 1;
+      }
+
+      h = hormone[t][ts % maxTs][d];
+
+      d1 = floor(dnew[d][h]);
+      d2 = ceil(dnew[d][h]);
+      ddec = dnew[d][h]-d1;
+
+      reproduce = maxTs > 1 ? ts % (maxTs - 1) : 0;
+
+      if (Uniform(mt)<ddec) d = d2; else d = d1;
+
+      int row[simColumns] = {time_i, t, ts, d, h, attack, reproduce};
+      rows.insert(rows.end(), row, row + simColumns);
+      ++ts;
+    } // for time_i time sim max
+} // end SimLife()
+
+
+
+/* WRITE OUT A SIMULATED SERIES OF ATTACKS */
+inline void SimAttacks()
+{
+  int k,c;
+  std::vector<int> rows;
+
+  ///////////////////////////////////////////////////////
+  outfile.str("");
+  outfile << "simAttacksL";
+  outfile << std::fixed << pLeave;
+  outfile << "A";
+  outfile << std::fixed << pArrive;
+  outfile << "Kmort";
+  outfile << std::fixed << Kmort;
+  outfile << "Kfec";
+  outfile << std::fixed << Kfec;
+  outfile << ".txt";
+  std::string attsimfilename = outfile.str();
+  attsimfile.open(attsimfilename.c_str());
+  ///////////////////////////////////////////////////////
+
+  attsimfile << "time" << "\t" << "t" << "\t" << (seasonal ? "ts\t" : "") << "damage" << "\t" << "hormone" << "\t" << "attack" << "\t" << (seasonal ? "reproduce\t" : "") << std::endl; // column headings in output file
+
+  SimLife(rows);
+
+  for (k=0;k<(int)rows.size();k+=simColumns)
+  {
+      for (c=0;c<simColumns;++c)
+      {
+          // without seasons there is no ts (column 2) and every step reproduces (column 6)
+          if (!seasonal && (c == 2 || c == 6)) continue;
+
+          attsimfile << rows[k+c] << "\t";
+      }
+
+      attsimfile << std::endl; // print data
+  }
+
+  if (!quiet) std::cout << rows.size() / simColumns << std::endl;
+
+  attsimfile.close();
+
+} // end void SimAttacks()
+
+
+
+// Paired simulation: lives under two strategies driven by common random
+// numbers. Draw j of step s of life k depends only on (seed, k, s, j), never
+// on what happened before, so the two strategies meet the same attacks,
+// deaths and damage roundings wherever their states allow, and the spread of
+// the differences between them is what the strategies make, not the draws
+
+inline const int simDraws = 4;        // uniforms a simulated step takes: attack, killed, background death, damage rounding
+inline const int simCap = 100000;     // steps after which a simulated life is cut short (it has outlived mu0 many times over)
+
+// outcome of one simulated life
+struct Life
+{
+    double repro;   // reproductive output summed over the life
+    int steps;      // time steps survived
+};
+
+// a paired comparison of one outcome
+struct PairedStat
+{
+    double meanA, meanB;   // means under the two strategies
+    double diff;           // mean of the paired differences A - B
+    double se;             // its standard error
+    double lo, hi;         // 95% confidence interval of diff
+    double seUnpaired;     // standard error diff would have had with independent draws
+};
+
+
+/* SPLITMIX64 FINALISER */
+inline uint64_t Mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+    return x ^ (x >> 31);
+} // end Mix()
+
+
+/* DRAW j OF STEP s OF THE LIFE WHOSE STREAM IS life, UNIFORM IN [0,1) */
+inline double StreamUniform(uint64_t life, uint64_t s, int j)
+{
+    return double(Mix(life ^ (s*simDraws + j)) >> 11) * 0x1.0p-53;
+} // end StreamUniform()
+
+
+/* ONE STEP OF THE LIFE WHOSE STREAM IS life, AS STEP s OF IT, FROM (t,ts,d); returns whether it survived the step */
+inline bool SimStep(uint64_t life, int s, int &t, int &ts, int &d, Life &out, long *byD, long *byH)
+{
+    int h,t1,ts1;
+    bool attacked;
+
+    // a step as in FitRow(): the hormone level chosen in (t,ts,d) meets an
+    // attack with the probability of the next t, and the survivors reproduce
+    // and take their new damage level in the next ts
+    t1 = std::min(maxT-1,t+1);
+    ts1 = (ts + 1) % maxTs;
+    h = hormone[t][ts][d];
+
+    if (byD != NULL)
+    {
+        ++byD[d];
+        ++byH[h];
+    }
+
+    attacked = StreamUniform(life, s, 0) < pPred[t1]*pAttack;
+
+    if (attacked && StreamUniform(life, s, 1) < pKilled[h]) return false;
+    if (StreamUniform(life, s, 2) < mu[d]) return false;
+
+    out.repro += repro[ts1][d];
+    d = StreamUniform(life, s, 3) < dfrac[d][h] ? dhigh[d][h] : dlow[d][h];
+    t = attacked ? 0 : t1;
+    ts = ts1;
+
+    return true;
+} // end SimStep()
+
+
+/* SIMULATE LIFE k UNDER THE STRATEGY OF THE LOADED MODEL, FROM t = maxT-1, ts = 0, d = 0; its steps are counted by damage level into byD and by hormone level into byH if they are given */
+inline Life SimStream(uint64_t seed, uint64_t k, long *byD = NULL, long *byH = NULL)
+{
+    int s,t,ts,d;
+    uint64_t life;
+    Life out;
+
+    life = Mix(Mix(seed) ^ k);
+
+    t = maxT - 1;
+    ts = 0;
+    d = 0;
+    out.repro = 0.0;
+
+    for (s=0;s<simCap && SimStep(life, s, t, ts, d, out, byD, byH);++s) {}
+
+    out.steps = s;
+
+    return out;
+} // end SimStream()
+
+
+
+// Event-driven lives. Long after the last attack (t = maxT-1) pPred no longer
+// changes, and at many damage levels every hormone level of the season keeps
+// the damage where it is. There the only things that can happen are an attack
+// and background death, with the same chance 1 - (1-pPred*pAttack)(1-mu[d])
+// every step, so the quiet steps until the next one are a geometric draw, and
+// a life skips ahead over them with the reproduction of the season cycles it
+// passes summed at once. The lives follow the same distribution as with
+// SimStream(), but not the same draws
+
+inline std::vector<char> calm;            // whether, at t = maxT-1, damage level d stays d whatever ts [maxD+1]
+inline std::vector<double> cycleRepro;    // reproductive output of a whole season at damage level d [maxD+1]
+
+
+/* FIND THE DAMAGE LEVELS AT WHICH A LIFE CAN SKIP AHEAD UNDER THE STRATEGY OF THE LOADED MODEL */
+inline void SimCalm()
+{
+    int d,ts,h;
+
+    calm.assign(maxD+1, 1);
+    cycleRepro.assign(maxD+1, 0.0);
+
+    for (d=0;d<=maxD;++d)
+    {
+        for (ts=0;ts<maxTs;++ts)
+        {
+            h = hormone[maxT-1][ts][d];
+
+            if (dlow[d][h] != d || dhigh[d][h] != d) calm[d] = 0;
+
+            cycleRepro[d] += repro[ts][d];
+        }
+    }
+} // end SimCalm()
+
+
+/* SIMULATE LIFE k EVENT BY EVENT, AS SimStream() DOES STEP BY STEP; SimCalm() must have been called for the strategy */
+inline Life SimEvents(uint64_t seed, uint64_t k, long *byD = NULL, long *byH = NULL)
+{
+    int s,t,ts,d,h,j;
+    long g,cycles;
+    double pa,q;
+    bool attacked,killed;
+    uint64_t life;
+    Life out;
+
+    life = Mix(Mix(seed) ^ k);
+
+    t = maxT - 1;
+    ts = 0;
+    d = 0;
+    out.repro = 0.0;
+    pa = pPred[maxT-1]*pAttack;
+
+    for (s=0;s<simCap;)
+    {
+        if (t < maxT-1 || !calm[d])
+        {
+            if (!SimStep(life, s, t, ts, d, out, byD, byH)) break;
+
+            ++s;
+            continue;
+        }
+
+        // g quiet steps, then an attack or death at step s+g
+        q = 1.0 - (1.0-pa)*(1.0-mu[d]);
+        g = q < 1.0 ? long(std::min(double(simCap - s), floor(log(1.0 - StreamUniform(life, s, 0)) / log1p(-q)))) : 0;
+
+        // the quiet steps: whole seasons, then the steps left over
+        cycles = g / maxTs;
+        out.repro += cycles * cycleRepro[d];
+
+        if (byD != NULL)
+        {
+            byD[d] += g;
+
+            for (j=0;j<maxTs;++j) byH[hormone[maxT-1][j][d]] += cycles;
+        }
+
+        for (j=0;j<g % maxTs;++j)
+        {
+            if (byH != NULL) ++byH[hormone[maxT-1][ts][d]];
+
+            ts = (ts + 1) % maxTs;
+            out.repro += repro[ts][d];
+        }
+
+        // the event itself, given that something happens: an attack, or else
+        // background death. Its draws are the ones of step s, which the quiet
+        // steps have not used
+        if (s + g >= simCap)
+        {
+            s = simCap;
+            break;
+        }
+
+        h = hormone[maxT-1][ts][d];
+        attacked = StreamUniform(life, s, 1)*q < pa;
+        killed = !attacked || StreamUniform(life, s, 2) < pKilled[h] || StreamUniform(life, s, 3) < mu[d];
+        s += g;
+
+        if (byD != NULL)
+        {
+            ++byD[d];
+            ++byH[h];
+        }
+
+        if (killed) break;
+
+        ts = (ts + 1) % maxTs;
+        out.repro += repro[ts][d];
+        t = 0;
+        ++s;
+    }
+
+    out.steps = s;
+
+    return out;
+} // end SimEvents()
+
+
+/* SIMULATE LIVES 0, ..., n-1 ON STREAM seed UNDER THE STRATEGY OF THE LOADED MODEL */
+inline void SimStreams(uint64_t seed, long n, std::vector<Life> &lives)
+{
+    long k;
+
+    lives.resize(n);
+
+    for (k=0;k<n;++k)
+    {
+        lives[k] = SimStream(seed, k);
+    }
+} // end SimStreams()
+
+
+/* COMPARE a[k] WITH b[k], k = 0, ..., n-1, PAIRED */
+inline PairedStat Paired(const std::vector<double> &a, const std::vector<double> &b)
+{
+    long k,n;
+    double sa,sb,sd,qa,qb,qd,x;
+    PairedStat out;
+
+    n = a.size();
+    sa = sb = sd = 0.0;
+
+    for (k=0;k<n;++k)
+    {
+        sa += a[k];
+        sb += b[k];
+    }
+
+    out.meanA = sa / n;
+    out.meanB = sb / n;
+    out.diff = out.meanA - out.meanB;
+
+    // sums of squares about the means, which keeps the small differences exact
+    qa = qb = qd = 0.0;
+
+    for (k=0;k<n;++k)
+    {
+        x = a[k] - out.meanA;
+        qa += x*x;
+        x = b[k] - out.meanB;
+        qb += x*x;
+        x = a[k] - b[k] - out.diff;
+        qd += x*x;
+    }
+
+    out.se = n > 1 ? sqrt(qd / (n - 1) / n) : 0.0;
+    out.seUnpaired = n > 1 ? sqrt((qa + qb) / (n - 1) / n) : 0.0;
+    out.lo = out.diff - 1.96*out.se;
+    out.hi = out.diff + 1.96*out.se;
+
+    return out;
+} // end Paired()
+
+
+/* PAIRED COMPARISON OF LIVES a[k] AND b[k]: in repro the reproductive output, in steps the lifespan */
+inline void ComparePaired(const std::vector<Life> &a, const std::vector<Life> &b, PairedStat &repro, PairedStat &steps)
+{
+    size_t k;
+    std::vector<double> xa(a.size()),xb(b.size());
+
+    for (k=0;k<a.size();++k)
+    {
+        xa[k] = a[k].repro;
+        xb[k] = b[k].repro;
+    }
+
+    repro = Paired(xa, xb);
+
+    for (k=0;k<a.size();++k)
+    {
+        xa[k] = a[k].steps;
+        xb[k] = b[k].steps;
+    }
+
+    steps = Paired(xa, xb);
+} // end ComparePaired()
+
+
+
+// Summary of a large simulation in constant memory: each thread keeps its own
+// sketch of the lives it simulates, and the sketches are merged at the end.
+// Steps are counted by damage and hormone level in fixed bins, and the
+// lifespans and reproductive outputs go into KLL quantile sketches, which
+// keep O(kllK log(n/kllK)) of the n values and give any quantile to within
+// about 1/kllK in rank
+
+inline const int kllK = 200; // capacity of the top compactor of a quantile sketch
+
+// KLL quantile sketch: levels[h] holds values of weight 2^h
+struct Kll
+{
+    std::vector<std::vector<double> > levels;
+    uint64_t coin;      // state of the coin that picks which half of a compaction is kept
+    long n;             // values added, counting those of merged sketches
+};
+
+// summary of simulated lives
+struct SimSketch
+{
+    long lives;
+    double sumRepro, sumSteps;   // for the exact means
+    double sumRepro2;            // and the standard error of the mean reproductive output
+    std::vector<long> byD;       // steps spent at each damage level [maxD+1]
+    std::vector<long> byH;       // steps spent at each hormone level [maxH]
+    Kll repro, lifespan;
+};
+
+
+/* EMPTY QUANTILE SKETCH, ITS COIN SEEDED BY seed */
+inline void KllInit(Kll &s, uint64_t seed)
+{
+    s.levels.assign(1, std::vector<double>());
+    s.coin = seed;
+    s.n = 0;
+} // end KllInit()
+
+
+/* CAPACITY OF LEVEL h OF A SKETCH OF nlevels LEVELS: kllK at the top, shrinking by 2/3 a level down */
+inline size_t KllCapacity(int h, int nlevels)
+{
+    return std::max(2, int(kllK * pow(2.0/3.0, nlevels - 1 - h)));
+} // end KllCapacity()
+
+
+/* COMPACT EVERY LEVEL OF s THAT IS OVER ITS CAPACITY INTO THE LEVEL ABOVE */
+inline void KllCompress(Kll &s)
+{
+    int h;
+    size_t j,n;
+
+    for (h=0;h<(int)s.levels.size();++h)
+    {
+        if (s.levels[h].size() < KllCapacity(h, s.levels.size())) continue;
+
+        if (h + 1 == (int)s.levels.size()) s.levels.push_back(std::vector<double>());
+
+        std::vector<double> &level = s.levels[h];
+
+        std::sort(level.begin(), level.end());
+
+        // of each pair of neighbours, the one the coin picks goes up with
+        // twice the weight; with an odd number, the largest stays behind
+        s.coin = Mix(s.coin);
+        n = level.size() & ~size_t(1);
+
+        for (j=0;j<n;j+=2)
+        {
+            s.levels[h+1].push_back(level[j + (s.coin & 1)]);
+        }
+
+        level.erase(level.begin(), level.begin() + n);
+    }
+} // end KllCompress()
+
+
+/* ADD x TO THE QUANTILE SKETCH s */
+inline void KllAdd(Kll &s, double x)
+{
+    s.levels[0].push_back(x);
+    ++s.n;
+
+    if (s.levels[0].size() >= KllCapacity(0, s.levels.size())) KllCompress(s);
+} // end KllAdd()
+
+
+/* MERGE THE QUANTILE SKETCH b INTO a */
+inline void KllMerge(Kll &a, const Kll &b)
+{
+    size_t h;
+
+    if (a.levels.size() < b.levels.size()) a.levels.resize(b.levels.size());
+
+    for (h=0;h<b.levels.size();++h)
+    {
+        a.levels[h].insert(a.levels[h].end(), b.levels[h].begin(), b.levels[h].end());
+    }
+
+    a.n += b.n;
+
+    KllCompress(a);
+} // end KllMerge()
+
+
+/* q-QUANTILE OF THE VALUES IN s */
+inline double KllQuantile(const Kll &s, double q)
+{
+    size_t h,j;
+    double total,rank;
+    std::vector<std::pair<double,double> > items; // value, weight
+
+    for (h=0;h<s.levels.size();++h)
+    {
+        for (j=0;j<s.levels[h].size();++j)
+        {
+            items.push_back(std::make_pair(s.levels[h][j], double(size_t(1) << h)));
+        }
+    }
+
+    if (items.empty()) return 0.0;
+
+    std::sort(items.begin(), items.end());
+
+    total = 0.0;
+
+    for (j=0;j<items.size();++j) total += items[j].second;
+
+    rank = 0.0;
+
+    for (j=0;j+1<items.size();++j)
+    {
+        rank += items[j].second;
+
+        if (rank >= q*total) break;
+    }
+
+    return items[j].first;
+} // end KllQuantile()
+
+
+/* EMPTY SUMMARY, ITS QUANTILE SKETCHES SEEDED BY seed */
+inline void SketchInit(SimSketch &s, uint64_t seed)
+{
+    s.lives = 0;
+    s.sumRepro = 0.0;
+    s.sumRepro2 = 0.0;
+    s.sumSteps = 0.0;
+    s.byD.assign(maxD+1, 0);
+    s.byH.assign(maxH, 0);
+    KllInit(s.repro, Mix(seed));
+    KllInit(s.lifespan, Mix(seed + 1));
+} // end SketchInit()
+
+
+/* MERGE THE SUMMARY b INTO a */
+inline void SketchMerge(SimSketch &a, const SimSketch &b)
+{
+    int k;
+
+    a.lives += b.lives;
+    a.sumRepro += b.sumRepro;
+    a.sumRepro2 += b.sumRepro2;
+    a.sumSteps += b.sumSteps;
+
+    for (k=0;k<=maxD;++k) a.byD[k] += b.byD[k];
+    for (k=0;k<maxH;++k) a.byH[k] += b.byH[k];
+
+    KllMerge(a.repro, b.repro);
+    KllMerge(a.lifespan, b.lifespan);
+} // end SketchMerge()
+
+
+// Batch lives: a thread takes simChunk lives at a time and moves them through
+// each step together, their state held as structure of arrays. The step takes
+// the draws of survival and damage whether or not they are needed and decides
+// with selects rather than branches, and the lives that end drop out of the list of those still going,
+// so the loop runs straight through the lives left. As the draws are the ones
+// of SimStream(), every life ends exactly as it does there
+
+inline const int simChunk = 4096; // lives a thread moves through the steps together
+
+// lives of a batch, structure of arrays
+struct Cohort
+{
+    std::vector<uint64_t> life;    // stream of each life
+    std::vector<int> t, ts, d;
+    std::vector<double> repro;     // reproductive output so far
+    std::vector<int> steps;        // steps survived, once the life has ended
+    std::vector<int> going;        // lives still going, in order
+};
+
+
+/* SIMULATE LIVES k0, ..., k0+n-1 UNDER THE STRATEGY OF THE LOADED MODEL IN LOCKSTEP, IN c, INTO THE SUMMARY s */
+inline void SimBatch(uint64_t seed, long k0, int n, Cohort &c, SimSketch &s)
+{
+    int i,j,m,step,t,ts,d,h,t1,ts1;
+    bool attacked,died;
+    double u0,u1,u2,u3;
+
+    c.life.resize(n);
+    c.t.assign(n, maxT - 1);
+    c.ts.assign(n, 0);
+    c.d.assign(n, 0);
+    c.repro.assign(n, 0.0);
+    c.steps.assign(n, simCap);
+    c.going.resize(n);
+
+    for (i=0;i<n;++i)
+    {
+        c.life[i] = Mix(Mix(seed) ^ uint64_t(k0 + i));
+        c.going[i] = i;
+    }
+
+    for (step=0;step<simCap && !c.going.empty();++step)
+    {
+        m = 0;
+
+        for (j=0;j<(int)c.going.size();++j)
+        {
+            i = c.going[j];
+            t = c.t[i];
+            ts = c.ts[i];
+            d = c.d[i];
+
+            // as in SimStep()
+            t1 = std::min(maxT-1,t+1);
+            ts1 = (ts + 1) % maxTs;
+            h = hormone[t][ts][d];
+
+            ++s.byD[d];
+            ++s.byH[h];
+
+            u0 = StreamUniform(c.life[i], step, 0);
+            u2 = StreamUniform(c.life[i], step, 2);
+            u3 = StreamUniform(c.life[i], step, 3);
+
+            attacked = u0 < pPred[t1]*pAttack;
+
+            // attacks are rare enough that the kill draw is best taken only then
+            u1 = attacked ? StreamUniform(c.life[i], step, 1) : 1.0;
+            died = (attacked & (u1 < pKilled[h])) | (u2 < mu[d]);
+
+            c.repro[i] += died ? 0.0 : repro[ts1][d];
+            c.d[i] = u3 < dfrac[d][h] ? dhigh[d][h] : dlow[d][h];
+            c.t[i] = attacked ? 0 : t1;
+            c.ts[i] = ts1;
+            c.steps[i] = died ? step : c.steps[i];
+
+            c.going[m] = i;
+            m += !died;
+        }
+
+        c.going.resize(m);
+    }
+
+    for (i=0;i<n;++i)
+    {
+        ++s.lives;
+        s.sumRepro += c.repro[i];
+        s.sumRepro2 += c.repro[i]*c.repro[i];
+        s.sumSteps += c.steps[i];
+        KllAdd(s.repro, c.repro[i]);
+        KllAdd(s.lifespan, c.steps[i]);
+    }
+} // end SimBatch()
+
+
+/* SIMULATE LIVES 0, ..., n-1 ON STREAM seed UNDER THE STRATEGY OF THE LOADED MODEL, ON ALL THREADS, INTO THE SUMMARY s */
+inline void SimSketches(uint64_t seed, long n, SimSketch &s)
+{
+    int k;
+    std::vector<SimSketch> part(team.n);
+
+    if (simEngine == "event") SimCalm();
+
+    TeamRun([&](int id) {
+        long k;
+        Life life;
+        Cohort c;
+        SimSketch &mine = part[id];
+
+        // life k is the same whichever thread lives it
+        SketchInit(mine, seed + id);
+
+        if (simEngine == "batch")
+        {
+            for (k=id*long(simChunk);k<n;k+=team.n*long(simChunk))
+            {
+                SimBatch(seed, k, std::min(long(simChunk), n - k), c, mine);
+            }
+
+            return;
+        }
+
+        for (k=id;k<n;k+=team.n)
+        {
+            life = simEngine == "event" ? SimEvents(seed, k, &mine.byD[0], &mine.byH[0]) : SimStream(seed, k, &mine.byD[0], &mine.byH[0]);
+
+            ++mine.lives;
+            mine.sumRepro += life.repro;
+            mine.sumRepro2 += life.repro*life.repro;
+            mine.sumSteps += life.steps;
+            KllAdd(mine.repro, life.repro);
+            KllAdd(mine.lifespan, life.steps);
+        }
+    });
+
+    // in thread order, so that a run is repeated exactly on as many threads
+    s = part[0];
+
+    for (k=1;k<team.n;++k) SketchMerge(s, part[k]);
+} // end SimSketches()
+
+
+/* SIMULATE nLives LIVES AND WRITE A SUMMARY OF THEM */
+inline void SimSummary()
+{
+  int k;
+  double se;
+  SimSketch s;
+  const double q[] = {0.01, 0.05, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99};
+
+  SimSketches(seed, nLives, s);
+
+  ///////////////////////////////////////////////////////
+  outfile.str("");
+  outfile << "simSummaryL";
+  outfile << std::fixed << pLeave;
+  outfile << "A";
+  outfile << std::fixed << pArrive;
+  outfile << "Kmort";
+  outfile << std::fixed << Kmort;
+  outfile << "Kfec";
+  outfile << std::fixed << Kfec;
+  outfile << ".txt";
+  std::string summaryfilename = outfile.str();
+  std::ofstream summaryfile(summaryfilename.c_str());
+  ///////////////////////////////////////////////////////
+
+  summaryfile << "lives" << "\t" << s.lives << std::endl
+      << "seed" << "\t" << seed << std::endl
+      << "mean_repro" << "\t" << std::setprecision(8) << s.sumRepro / s.lives << std::endl
+      << "mean_lifespan" << "\t" << s.sumSteps / s.lives << std::endl;
+
+  // the mean reproductive output against what the DP expects of the strategy
+  se = s.lives > 1 ? sqrt((s.sumRepro2 - s.sumRepro*s.sumRepro/s.lives) / (s.lives - 1) / s.lives) : 0.0;
+
+  summaryfile << "se_repro" << "\t" << se << std::endl
+      << "dp_fitness" << "\t" << startFit << std::endl
+      << "z" << "\t" << (se > 0.0 ? (s.sumRepro / s.lives - startFit) / se : 0.0) << std::endl
+      << std::endl;
+
+  summaryfile << "quantile" << "\t" << "repro" << "\t" << "lifespan" << std::endl;
+
+  for (k=0;k<int(sizeof(q)/sizeof(q[0]));++k)
+  {
+      summaryfile << q[k] << "\t" << KllQuantile(s.repro, q[k]) << "\t" << KllQuantile(s.lifespan, q[k]) << std::endl;
+  }
+
+  // steps spent at each level, the empty hormone levels left out
+  summaryfile << std::endl << "damage" << "\t" << "steps" << std::endl;
+
+  for (k=0;k<=maxD;++k) summaryfile << k << "\t" << s.byD[k] << std::endl;
+
+  summaryfile << std::endl << "hormone" << "\t" << "steps" << std::endl;
+
+  for (k=0;k<maxH;++k)
+  {
+      if (s.byH[k] > 0) summaryfile << k << "\t" << s.byH[k] << std::endl;
+  }
+
+  summaryfile.close();
+
+  if (!quiet) std::cout << "simulated " << s.lives << " lives, mean reproductive output " << s.sumRepro / s.lives << std::endl;
+} // end SimSummary()
+
+
+/* COMPARE THE STRATEGY OF THE SINGLE PRECISION PHASE WITH THE POLISHED ONE */
+inline void PrintPrecision()
+{
+  int t,d,ts,ndiff,maxdiff;
+
+  ///////////////////////////////////////////////////////
+  outfile.str("");
+  outfile << "precisionL";
+  outfile << std::fixed << pLeave;
+  outfile << "A";
+  outfile << std::fixed << pArrive;
+  outfile << "Kmort";
+  outfile << std::fixed << Kmort;
+  outfile << "Kfec";
+  outfile << std::fixed << Kfec;
+  outfile << ".txt";
+  std::string precisionfilename = outfile.str();
+  std::ofstream precisionfile(precisionfilename.c_str());
+  ///////////////////////////////////////////////////////
+
+  precisionfile << "t" << "\t" << "d" << "\t" << "ts" << "\t" << "hormone_float" << "\t" << "hormone_double" << std::endl;
+
+  ndiff = 0;
+  maxdiff = 0;
+
+  for (t=0;t<maxT;++t)
+  {
+      for (ts = 0; ts < maxTs; ++ts)
+      {
+        for (d=0;d<=maxD;++d)
+        {
+            if (hormoneFloat[t][ts][d] != hormone[t][ts][d])
+            {
+                ++ndiff;
+                maxdiff = std::max(maxdiff, std::abs(hormoneFloat[t][ts][d] - hormone[t][ts][d]));
+                precisionfile << t << "\t" << d << "\t" << ts << "\t" << hormoneFloat[t][ts][d] << "\t" << hormone[t][ts][d] << std::endl;
+            }
+        }
+      }
+  }
+
+  precisionfile.close();
+
+  outputfile << "floatIterations" << "\t" << iFloat << std::endl;
+  outputfile << "hormoneDiffCells" << "\t" << ndiff << std::endl;
+  outputfile << "hormoneDiffMax" << "\t" << maxdiff << std::endl;
+  outputfile << std::endl;
+
+  std::cout << "single precision strategy differs in " << ndiff << " cells, by at most " << maxdiff << std::endl;
+} // end PrintPrecision()
+
+
+
+/* GRID FILE: NAMED DENSE ARRAYS FOR PLOTTING, READ BY load_grids() IN single_dp_plot.py
+
+   char magic[8] "SDGRIDS", int32 number of grids, then per grid:
+   char name[16], char dtype[8] (int32 or float64), int32 ndim,
+   per axis char name[8], int32 n, int32 values[n],
+   then the values, row-major, the last axis running fastest */
+inline void GridField(std::ofstream &file, const char *text, size_t width)
+{
+  std::vector<char> field(width, 0);
+
+  memcpy(&field[0], text, std::min(strlen(text), width-1));
+  file.write(&field[0], width);
+}
+
+inline void GridBegin(std::ofstream &file, const char *name, const char *dtype, int ndim)
+{
+  GridField(file, name, 16);
+  GridField(file, dtype, 8);
+  file.write((const char *)&ndim, sizeof(ndim));
+}
+
+inline void GridAxis(std::ofstream &file, const char *name, int first, int n)
+{
+  int k,value;
+
+  GridField(file, name, 8);
+  file.write((const char *)&n, sizeof(n));
+
+  for (k=0;k<n;++k)
+  {
+      value = first + k;
+      file.write((const char *)&value, sizeof(value));
+  }
+}
+
+
+
+/* WRITE THE STRATEGY, AND THE MARGINALS OF THE FORWARD CALCULATION IF IT RAN, AS DENSE GRIDS */
+inline void PrintGrids()
+{
+  int t,ts,d,ngrids;
+  std::vector<int> row(maxT);
+
+  ///////////////////////////////////////////////////////
+  outfile.str("");
+  outfile << "gridsL";
+  outfile << std::fixed << pLeave;
+  outfile << "A";
+  outfile << std::fixed << pArrive;
+  outfile << "Kmort";
+  outfile << std::fixed << Kmort;
+  outfile << "Kfec";
+  outfile << std::fixed << Kfec;
+  outfile << ".bin";
+  std::string gridsfilename = outfile.str();
+  std::ofstream gridsfile(gridsfilename.c_str(), std::ios::binary);
+  ///////////////////////////////////////////////////////
+
+  ngrids = runFwdCalc ? 3 : 1;
+
+  gridsfile.write("SDGRIDS", 8);
+  gridsfile.write((const char *)&ngrids, sizeof(ngrids));
+
+  // hormone over (d,t), one grid per ts
+  GridBegin(gridsfile, "hormone", "int32", 3);
+  GridAxis(gridsfile, "ts", 0, maxTs);
+  GridAxis(gridsfile, "d", 0, maxD+1);
+  GridAxis(gridsfile, "t", 0, maxT);
+
+  for (ts=0;ts<maxTs;++ts)
+  {
+      for (d=0;d<=maxD;++d)
+      {
+          for (t=0;t<maxT;++t) row[t] = hormone[t][ts][d];
+
+          gridsfile.write((const char *)&row[0], maxT*sizeof(int));
+      }
+  }
+
+  if (runFwdCalc)
+  {
+      // frequencies over (d,t) and (d,h); t = 0 is never occupied
+      GridBegin(gridsfile, "F_dt", "float64", 2);
+      GridAxis(gridsfile, "d", 0, maxD+1);
+      GridAxis(gridsfile, "t", 1, maxT-1);
+
+      for (d=0;d<=maxD;++d) gridsfile.write((const char *)&freqDT[d][1], (maxT-1)*sizeof(double));
+
+      GridBegin(gridsfile, "F_dh", "float64", 2);
+      GridAxis(gridsfile, "d", 0, maxD+1);
+      GridAxis(gridsfile, "h", 0, maxH);
+
+      for (d=0;d<=maxD;++d) gridsfile.write((const char *)freqDH[d], maxH*sizeof(double));
+  }
+
+  gridsfile.close();
+} // end PrintGrids()
+
+
+
+/* NUMBER OF STRATEGY ENTRIES THAT DIFFER FROM last, WHICH IS THEN UPDATED */
+inline int PolicyChanges(std::vector<int> &last)
+{
+    size_t k,n;
+    int changes;
+    const int *h = hormone[0][0];
+
+    n = size_t(maxT)*maxTs*(maxD+1);
+    changes = last.size() == n ? 0 : int(n);
+
+    last.resize(n);
+
+    for (k=0;k<n;++k)
+    {
+        if (last[k] != h[k]) ++changes;
+        last[k] = h[k];
+    }
+
+    return changes;
+} // end PolicyChanges()
+
+
+
+/* ITERATE UNTIL THE STRATEGY HAS CONVERGED ON THE OPTIMAL SOLUTION; returns false if it did not */
+template <typename Real>
+bool ValueIteration(Tensors<Real> &S, double vtol)
+{
+    int stalled,stable,growing,sinceLow;
+    double lastfitdiff,contraction,lastmaxdiff,lowmaxdiff;
+    std::vector<int> lastHormone;
+    bool byPolicy;
+    std::ostringstream why;
+
+    stalled = 0;
+    lastfitdiff = HUGE_VAL;
+
+    // the same contraction keeps V bounded, so a point where the largest
+    // change in V keeps growing, or stops shrinking long before tol, cannot
+    // converge and is given up rather than run to maxI. A switch of the
+    // strategy makes the change jump for one to three iterations (up to
+    // fivefold on the survival grid of stress_damage.cpp), so it takes
+    // watchGrowth iterations of growth beyond watchSlack in a row: a point
+    // with invalid parameters grows at every iteration and is still given
+    // up within watchGrowth. Single precision is left to its own stall
+    // test, as its rounding error can make the change grow for a while
+    growing = 0;
+    sinceLow = 0;
+    lastmaxdiff = HUGE_VAL;
+    lowmaxdiff = HUGE_VAL;
+
+    // --stop=policy: the strategy is what is wanted, so stop once it has
+    // stood still for stableIters iterations and V is within vtol of the
+    // optimal fitness. An iteration takes V through maxTs steps, each of
+    // which shrinks differences by at least the survival probability
+    // 1 - mu[d], so the distance of V from the optimum is at most
+    // contraction/(1 - contraction) times its largest change
+    byPolicy = stopRule == "policy" && sizeof(Real) == sizeof(double);
+    contraction = pow(1.0 - *std::min_element(mu.begin(), mu.end()), maxTs);
+    stable = 0;
+    fitBound = HUGE_VAL;
+    stoppedBy = "none";
+
+    for (;i<=maxI;++i)
+    {
+        OptDec(S);
+        ReplaceFit(S);
+
+        if ((i%skip==0 || totfitdiff < vtol) && !quiet)
+        {
+          std::cout << i << "\t" << totfitdiff << std::endl; // show fitness difference every 'skip' generations
+        }
+
+        if (totfitdiff < vtol) // strategy has converged on optimal solution, so exit loop
+        {
+            stoppedBy = "residual";
+            return true;
+        }
+
+        growing = maxfitdiff >= vtol && maxfitdiff > lastmaxdiff*(1.0 + watchSlack) ? growing + 1 : 0;
+        sinceLow = maxfitdiff < lowmaxdiff ? 0 : sinceLow + 1;
+        lastmaxdiff = maxfitdiff;
+        lowmaxdiff = std::min(lowmaxdiff, maxfitdiff);
+
+        if (!std::isfinite(totfitdiff))
+        {
+            failKind = "nan";
+            why << "the fitness difference is " << totfitdiff;
+        }
+        else if (sizeof(Real) == sizeof(double) && growing >= watchGrowth)
+        {
+            failKind = "divergence";
+            why << "the largest change in V grew " << growing << " times running, to " << maxfitdiff;
+        }
+        else if (sizeof(Real) == sizeof(double) && sinceLow >= watchStall)
+        {
+            failKind = "stagnation";
+            why << "the largest change in V has not gone below " << lowmaxdiff << " in " << sinceLow << " iterations";
+        }
+
+        if (!failKind.empty())
+        {
+            failDetail = why.str();
+            stoppedBy = "none";
+            return false;
+        }
+
+        if (byPolicy)
+        {
+            stable = PolicyChanges(lastHormone) == 0 ? stable + 1 : 0;
+            fitBound = contraction < 1.0 ? contraction/(1.0 - contraction)*maxfitdiff : HUGE_VAL;
+
+            if (stable >= stableIters && fitBound < vtol)
+            {
+                if (!quiet) std::cout << i << "\t" << totfitdiff << "\t" << "strategy unchanged for " << stable << " iterations" << std::endl;
+
+                stoppedBy = "policy";
+                return true;
+            }
+        }
+
+        // single precision cannot resolve residuals below its rounding error,
+        // so hand over to double precision once the residual stalls
+        stalled = totfitdiff < lastfitdiff ? 0 : stalled + 1;
+        lastfitdiff = totfitdiff;
+
+        if (sizeof(Real) < sizeof(double) && stalled >= floatStall) return false;
+    }
+
+    return false;
+} // end ValueIteration()
+
+
+
+/* WHAT IS WRONG WITH THE PARAMETERS p = pLeave, pArrive, pAttack, alpha, Kmort, Kfec; empty if nothing */
+inline std::string CheckParams(const double p[6])
+{
+    int k;
+    std::ostringstream why;
+    const char *names[6] = {"pLeave", "pArrive", "pAttack", "alpha", "Kmort", "Kfec"};
+
+    for (k=0;k<6;++k)
+    {
+        if (!std::isfinite(p[k]))
+        {
+            why << names[k] << " must be a finite number, not " << p[k];
+        }
+        else if (k < 3 && (p[k] < 0.0 || p[k] > 1.0))
+        {
+            why << names[k] << " is a probability, so must lie between 0 and 1, not " << p[k];
+        }
+        else if (p[k] < 0.0)
+        {
+            why << names[k] << " must not be negative, not " << p[k];
+        }
+
+        if (!why.str().empty()) break;
+    }
+
+    // PredProb() would divide by the chance of not being attacked, which is then 0
+    if (why.str().empty() && p[2] == 1.0 && (p[0] == 0.0 || p[1] == 1.0))
+    {
+        why << "with pAttack = 1 and " << (p[0] == 0.0 ? "pLeave = 0" : "pArrive = 1") << " a predator is sure to be present and to attack, so pPred is undefined";
+    }
+
+    return why.str();
+} // end CheckParams()
+
+
+
+/* BUILD THE TABLES OF THE MODEL, WITH THE COMPONENTS OF F, FOR THE CURRENT PARAMETERS AND GRID */
+template <typename F = StandardForm>
+void Setup()
+{
+    AllocTables();
+    Reproduction<F>();
+    PredProb();
+    Predation<F>();
+    Mortality<F>();
+    Damage<F>();
+    HormoneFloor<F>();
+} // end Setup()
+
+
+
+/* TAKE THE STRATEGY FROM THE ARENA; it stays there through the forward calculation and the simulation */
+inline void AllocStrategy()
+{
+    hormone.Alloc(maxT, maxTs, maxD+1);
+    FirstTouch(hormone);
+
+    if (precision == "mixed")
+    {
+        hormoneFloat.Alloc(maxT, maxTs, maxD+1);
+        FirstTouch(hormoneFloat);
+    }
+} // end AllocStrategy()
+
+
+
+/* FIND THE OPTIMAL STRATEGY, WITH THE FITNESS ARRAYS IN S, STARTING FROM THE SOLUTION warm IF GIVEN; returns whether it converged */
+inline bool Solve(Tensors<double> &S, Tensors<double> *warm = NULL)
+{
+    bool converged;
+
+    if (!quiet) std::cout << "i" << "\t" << "totfitdiff" << "\t" << std::endl;
+
+    i = 1;
+    failKind.clear();
+    failDetail.clear();
+
+    // a warm start is close enough already for single precision to have nothing to add
+    if (precision == "mixed" && warm == NULL)
+    {
+        Tensors<float> Sf;
+
+        // the single precision arrays take the upper half of the double precision ones
+        AllocFit(S);
+        Overlay(S, Sf);
+        FinalFit(Sf);
+        ValueIteration(Sf, floatTol);
+
+        iFloat = i;
+
+        if (!failKind.empty()) return false;
+
+        TeamRun([](int id) {
+            int tlo,thi;
+
+            TBlock(id, tlo, thi);
+            std::copy(hormone[tlo][0], hormone[thi][0], hormoneFloat[tlo][0]);
+        });
+
+        // polish in double precision, starting from the single precision solution
+        Promote(Sf, S);
+        ++i;
+    }
+    else
+    {
+        AllocFit(S);
+
+        if (warm != NULL) WarmFit(S, *warm); else FinalFit(S);
+    }
+
+    converged = ValueIteration(S, tol);
+
+    // what a simulated life should reproduce, on average
+    if (failKind.empty()) startFit = S.Wopt[maxT-1][0][0];
+
+    return converged;
+} // end Solve()
+
+
+
+// Finite horizon: a life of horizon seasons, horizon*maxTs steps, solved in
+// one backward pass over age with no convergence loop. Age a is step a of
+// life, in season step ts = a % maxTs, and only needs the fitness of age
+// a+1, so two slices of W take turns. The strategy of each age is written
+// to horizonL*.txt as soon as it is found, the last age first. Beyond the
+// last age there is nothing more to gain, so the pass starts from zero
+
+/* SOLVE THE CURRENT PARAMETER POINT FOR A LIFESPAN OF horizon SEASONS AND WRITE THE STRATEGY OF EVERY AGE */
+inline void Horizon()
+{
+    int a,ages,ts,t,d;
+    Tensor3<double> Wa[2]; // W of the age being solved and of the age after it, [t][d][h]
+    Table2<double> Wopt;   // fitness under the optimal decision at the age being solved [maxT][maxD+1]
+    Table2<int> hOpt;      // and that decision
+
+    ages = horizon*maxTs;
+
+    Wa[0].Alloc(maxT, maxD+1, maxH);
+    Wa[1].Alloc(maxT, maxD+1, maxH);
+    FirstTouch(Wa[0]);
+    FirstTouch(Wa[1]);
+    Wopt.Resize(maxT, maxD+1);
+    hOpt.Resize(maxT, maxD+1);
+
+    ///////////////////////////////////////////////////////
+    outfile.str("");
+    outfile << "horizonL";
+    outfile << std::fixed << pLeave;
+    outfile << "A";
+    outfile << std::fixed << pArrive;
+    outfile << "Kmort";
+    outfile << std::fixed << Kmort;
+    outfile << "Kfec";
+    outfile << std::fixed << Kfec;
+    outfile << ".txt";
+    std::string horizonfilename = outfile.str();
+    outputfile.open(horizonfilename.c_str());
+    ///////////////////////////////////////////////////////
+
+    outputfile << "age" << "\t" << "t" << "\t" << "d" << "\t" << (seasonal ? "ts\t" : "") << "hormone" << std::endl;
+
+    for (a=ages-1;a>=0;--a)
+    {
+        ts = a % maxTs;
+        Tensor3<double> &W = Wa[a % 2];
+        Tensor3<double> &Wnext = Wa[(a + 1) % 2]; // zero at the last age
+
+        // optimal decision for every t, as in OptDecRow(), then the fitness
+        // it gives, as in FitRow(); every W needs Wopt[0], hence two runs
+        TeamRun([&](int id) {
+            int t,d,tlo,thi;
+
+            TBlock(id, tlo, thi);
+
+            for (t=tlo;t<thi;++t)
+            {
+                for (d=0;d<=maxD;++d)
+                {
+                    if (search == "exhaustive") hOpt[t][d] = ScanRow(Wnext[std::min(maxT-1,t+1)][d], Wopt[t][d]);
+                    else hOpt[t][d] = SearchRow(Wnext[std::min(maxT-1,t+1)][d], hLow[d], Wopt[t][d]);
+                }
+            }
+        });
+
+        TeamRun([&](int id) {
+            int t,d,tlo,thi;
+
+            TBlock(id, tlo, thi);
+
+            for (t=std::max(1,tlo);t<thi;++t) // note that W is undefined for t=0 because t=1 if predator has just attacked
+            {
+                for (d=0;d<=maxD;++d)
+                {
+                    FitValues(W[t][d], d, pPred[t]*pAttack, repro[ts][d], Wopt[0], Wopt[t]);
+                }
+            }
+        });
+
+        for (t=0;t<maxT;++t)
+        {
+            for (d=0;d<=maxD;++d)
+            {
+                outputfile << a << "\t" << t << "\t" << d << "\t";
+                if (seasonal) outputfile << ts << "\t";
+                outputfile << hOpt[t][d] << std::endl;
+            }
+        }
+    }
+
+    // where a life starts, as for startFit
+    startFit = Wopt[maxT-1][0];
+
+    outputfile << std::endl;
+    outputfile << "ages" << "\t" << ages << std::endl;
+    outputfile << "fitness" << "\t" << std::setprecision(8) << startFit << std::endl;
+
+    PrintParams();
+    outputfile << "horizon: " << "\t" << horizon << std::endl;
+    outputfile.close();
+} // end Horizon()
+
+
+
+/* SOLVE THE CURRENT PARAMETER POINT AND WRITE ITS OUTPUT FILES; returns whether it converged.
+   A front-end adds its own output with printMore, which writes to the strategy file after the
+   strategy, and with written, which gets whether it converged once that file is closed */
+inline bool RunPoint(const std::function<void()> &printMore = nullptr, const std::function<void(bool)> &written = nullptr)
+{
+    const double p[6] = {pLeave, pArrive, pAttack, alpha, Kmort, Kfec};
+
+    // a bad point costs an error record, not a solve
+    failDetail = CheckParams(p);
+
+    if (!failDetail.empty())
+    {
+        failKind = "invalid";
+        TeamLead(PrintError);
+        return false;
+    }
+
+    Setup();
+
+    Tensors<double> S;
+    Tensors<double> freq;
+    bool converged;
+    size_t base,mark;
+
+    base = arena.used; // everything of this point is handed back at the end
+
+    // a finite lifespan is one backward pass, written out as it goes
+    if (horizon > 0)
+    {
+        Horizon();
+        ArenaRelease(base);
+        return true;
+    }
+
+    AllocStrategy();
+
+    mark = arena.used;
+
+    converged = Solve(S);
+
+    // given up by the watchdog: the arrays hold nothing worth writing
+    if (!failKind.empty())
+    {
+        TeamLead(PrintError);
+        ArenaRelease(base);
+        return false;
+    }
+
+    // with --procs, only the first process writes the output, and the
+    // others wait for it before the arena is used for the next point
+    TeamLead([&]() {
+
+        ///////////////////////////////////////////////////////
+        outfile.str("");
+        outfile << "stressL";
+        outfile << std::fixed << pLeave;
+        outfile << "A";
+        outfile << std::fixed << pArrive;
+        outfile << "Kmort";
+        outfile << std::fixed << Kmort;
+        outfile << "Kfec";
+        outfile << std::fixed << Kfec;
+        outfile << ".txt";
+        std::string outputfilename = outfile.str();
+        outputfile.open(outputfilename.c_str());
+        ///////////////////////////////////////////////////////
+
+        outputfile << "Random seed: " << seed << std::endl; // write seed to output file
+
+        if (!converged) { outputfile << "*** DID NOT CONVERGE WITHIN " << maxI << " ITERATIONS ***" << std::endl;}
+
+        if (!quiet) std::cout << std::endl;
+        outputfile << std::endl;
+
+        PrintStrat();
+
+        if (printMore) printMore();
+
+        if (precision == "mixed")
+        {
+            PrintPrecision();
+        }
+
+        PrintParams();
+        outputfile.close();
+
+        if (written) written(converged);
+
+        // the fitness arrays make way for the frequencies
+        ArenaRelease(mark);
+
+        if (runFwdCalc)
+        {
+            Forward(freq);
+            PrintFwd(freq);
+        }
+
+        if (gridDump) PrintGrids();
+
+        SimAttacks();
+
+        if (nLives > 0) SimSummary();
+
+    });
+
+    ArenaRelease(base);
+
+    return converged;
+} // end RunPoint()
+
+
+
+// one model: its parameters and settings, its arena and its results. The
+// engine works on the globals above, so a model is loaded into them while it
+// is worked on and saved back afterwards; any number of models can be kept,
+// but only one can be worked on at a time
+struct Model
+{
+    double pLeave, pArrive, pAttack, alpha, Kmort, Kfec;
+    int maxT, maxTs, maxD, maxH;
+    std::string precision;
+    bool inPlace, blocked;
+    int tileT;
+
+    Arena arena;
+    Tensor3<int> hormone;
+    Tensors<double> S;          // fitness arrays of the solution, and frequencies of the forward calculation
+    size_t fwdMark;             // arena in use before the forward calculation
+    bool solved, converged, forward;
+    int i;
+    double totfitdiff, predDeaths, damageDeaths, meanT;
+    std::vector<double> damageDist, hormoneDist; // marginals of the forward calculation
+    Table2<double> freqDT, freqDH;
+    std::vector<int> sim;       // rows of the last simulation, simColumns each
+};
+
+
+/* MAKE m THE MODEL THE ENGINE WORKS ON, FOR A FRONT-END THAT KEEPS MODELS BETWEEN CALLS */
+inline void ModelLoad(Model &m)
+{
+    quiet = true;
+    keepFit = true;    // so that W can still be read, and warm-start others, after the forward calculation
+    runFwdCalc = true; // and so that the arena has room for both
+
+    ::pLeave = m.pLeave;
+    ::pArrive = m.pArrive;
+    ::pAttack = m.pAttack;
+    ::alpha = m.alpha;
+    ::Kmort = m.Kmort;
+    ::Kfec = m.Kfec;
+    ::maxT = m.maxT;
+    ::maxTs = m.maxTs;
+    ::maxD = m.maxD;
+    ::maxH = m.maxH;
+    ::precision = m.precision;
+    ::inPlace = m.inPlace;
+    ::blocked = m.blocked;
+    ::tileT = m.tileT;
+
+    tOrder = SweepOrder("ascending", 1, maxT);
+    dOrder = SweepOrder("ascending", 0, maxD + 1);
+    tRedBlack = false;
+
+    ::arena = m.arena;
+    ::hormone = m.hormone;
+    ::i = m.i;
+    ::totfitdiff = m.totfitdiff;
+    ::predDeaths = m.predDeaths;
+    ::damageDeaths = m.damageDeaths;
+    ::meanT = m.meanT;
+    ::damageDist = m.damageDist;
+    ::hormoneDist = m.hormoneDist;
+    ::freqDT = m.freqDT;
+    ::freqDH = m.freqDH;
+
+    Setup();
+} // end ModelLoad()
+
+
+/* SAVE THE RESULTS OF THE ENGINE INTO m, WHICH STOPS BEING WORKED ON */
+inline void ModelSave(Model &m)
+{
+    Arena none = {NULL, 0, 0, false, -1, 0};
+
+    m.arena = ::arena;
+    m.hormone = ::hormone;
+    m.i = ::i;
+    m.totfitdiff = ::totfitdiff;
+    m.predDeaths = ::predDeaths;
+    m.damageDeaths = ::damageDeaths;
+    m.meanT = ::meanT;
+    m.damageDist = ::damageDist;
+    m.hormoneDist = ::hormoneDist;
+    m.freqDT = ::freqDT;
+    m.freqDH = ::freqDH;
+
+    // so that nothing else maps over or releases the model's arena
+    ::arena = none;
+    ::hormone = Tensor3<int>();
+} // end ModelSave()
+
+
+/* HAND BACK THE ARENA OF A MODEL */
+inline void ModelFree(Model &m)
+{
+    if (m.arena.base != NULL) munmap(m.arena.base, m.arena.capacity);
+    if (m.arena.fd >= 0) close(m.arena.fd);
+
+    m.arena.base = NULL;
+    m.arena.fd = -1;
+} // end ModelFree()
+
+
+/* SOLVE m, STARTING FROM THE SOLUTION OF warm IF GIVEN; returns whether it converged. If it was given
+   up, or its arrays could not be mapped, m is left unsolved with the reason in failKind and failDetail */
+inline bool ModelSolve(Model &m, Model *warm = NULL)
+{
+    ModelLoad(m);
+
+    m.S = Tensors<double>();
+    m.solved = false;
+    m.forward = false;
+
+    // a new solution starts from an empty arena
+    if (!ArenaReserve(Footprint()))
+    {
+        i = 0;
+        failKind = "memory";
+        failDetail = arenaError;
+        ModelSave(m);
+        return false;
+    }
+
+    ArenaRelease(0);
+    AllocStrategy();
+
+    // the warm model's arrays live in its own arena, which stays mapped
+    m.converged = Solve(m.S, warm != NULL ? &warm->S : NULL);
+    m.solved = failKind.empty();
+    m.fwdMark = arena.used;
+
+    ModelSave(m);
+
+    return m.converged;
+} // end ModelSolve()
+
+
+/* FORWARD CALCULATION OF THE SOLVED MODEL m; a second one takes the place of the first */
+inline void ModelForward(Model &m)
+{
+    ModelLoad(m);
+
+    ArenaRelease(m.fwdMark);
+
+    m.S.F = Tensor4<double>();
+    m.S.Fnext = Tensor4<double>();
+    Forward(m.S);
+    m.forward = true;
+
+    ModelSave(m);
+} // end ModelForward()
+
+
+/* SIMULATE ONE INDIVIDUAL UNDER THE SOLVED MODEL m THROUGH A RUN OF ATTACKS, INTO m.sim; returns its rows */
+inline int ModelSimulate(Model &m, unsigned int seed)
+{
+    ModelLoad(m);
+
+    mt.seed(seed);
+    m.sim.clear();
+    SimLife(m.sim);
+
+    ModelSave(m);
+
+    return m.sim.size() / simColumns;
+} // end ModelSimulate()
+
+
+/* SIMULATE LIVES 0, ..., n-1 ON STREAM seed UNDER THE STRATEGY OF THE SOLVED MODEL m */
+inline void ModelLives(Model &m, uint64_t seed, long n, std::vector<Life> &lives)
+{
+    ModelLoad(m);
+    SimStreams(seed, n, lives);
+    ModelSave(m);
+} // end ModelLives()
+
+#endif // STRESS_DAMAGE_LH_HPP
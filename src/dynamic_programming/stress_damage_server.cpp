@@ -0,0 +1,719 @@
+// **********************************************************************************
+// Solve server of the seasonal model: a long-lived local process that answers
+// solve, forward and simulate requests on a Unix domain socket, so that a
+// session calling the solver many times pays for process startup and memory
+// mapping once, and starts every value iteration from the nearest solution it
+// still holds rather than from scratch.
+//
+// Protocol: one request per line, one reply per request, starting with "ok" or
+// "error", followed by name=value fields
+//
+//   solve pLeave pArrive pAttack alpha Kmort Kfec
+//                          ok id=N converged=0|1 iterations=N warm=ID|- hit=0|1 seconds=S
+//                          (warm is the solution it started from; hit=1 if the point was
+//                          cached already, and nothing was solved)
+//   forward ID             ok id=N predDeaths=X damageDeaths=X
+//   simulate ID SEED       ok id=N rows=N
+//   compare ID ID N SEED   ok a=ID b=ID n=N repro=MEANA,MEANB,DIFF,SE,LO,HI,SEUNPAIRED lifespan=...
+//                          (N lives under each, on common random numbers: DIFF is A - B,
+//                          LO,HI its 95% interval, SEUNPAIRED its error with independent draws)
+//   get ID hormone|W|F|sim ok id=N array=NAME dtype=int32|float64 shape=N,N,...
+//                          with a memfd holding the array, C order, passed along
+//   drop ID                ok id=N
+//   stats                  ok models=N ids=N,N,... solves=N warm=N hits=N
+//   shutdown               ok
+//
+// The grid, layout and update rule are settings of the server, so that any
+// cached solution can warm-start any other.
+// **********************************************************************************
+
+#include "stress_damage_lh.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <map>
+
+// a solved model held by the server
+struct Entry
+{
+    int id;
+    Model model;
+    unsigned long used;   // request count when last used, for eviction
+};
+
+// a connected client
+struct Client
+{
+    int fd;
+    std::string in;       // bytes received but not yet a whole line
+};
+
+std::string socketPath = "stress_damage.sock"; // --socket=PATH
+int cacheSize = 4;                              // --cache=N: solved models kept
+bool warmStart = true;                          // --cold: always start from the final fitness
+
+std::map<int, Entry *> models;     // solved models by id
+std::vector<Arena> spare;          // arenas of evicted models, for reuse
+int nextId = 1;
+unsigned long nRequests = 0;
+unsigned long nSolves = 0, nWarm = 0, nHits = 0;
+
+volatile sig_atomic_t stop = 0;
+
+
+/* ASK THE MAIN LOOP TO STOP */
+void on_signal(int)
+{
+    stop = 1;
+} // end on_signal()
+
+
+/* READ OPTIONAL SETTINGS OF THE FORM --name=value */
+void init_options(int argc, char** argv)
+{
+    int arg;
+    size_t eq;
+    std::string opt,name,value;
+
+    for (arg = 1; arg < argc; ++arg)
+    {
+        opt = argv[arg];
+        eq = opt.find('=');
+        name = opt.substr(0, eq);
+        value = eq == std::string::npos ? "" : opt.substr(eq + 1);
+
+        if (name == "--socket" && !value.empty())
+        {
+            socketPath = value;
+        }
+        else if (name == "--cache" && atoi(value.c_str()) > 0)
+        {
+            cacheSize = atoi(value.c_str());
+        }
+        else if (name == "--cold")
+        {
+            warmStart = false;
+        }
+        else if (name == "--update" && (value == "jacobi" || value == "gauss-seidel"))
+        {
+            inPlace = value == "gauss-seidel";
+        }
+        else if (name == "--layout" && (value == "natural" || value == "blocked"))
+        {
+            blocked = value == "blocked";
+        }
+        else if (name == "--tile-t" && atoi(value.c_str()) > 0)
+        {
+            tileT = atoi(value.c_str());
+        }
+        else if (name == "--threads" && atoi(value.c_str()) > 0)
+        {
+            nThreads = atoi(value.c_str());
+        }
+        else if (name == "--maxT" && atoi(value.c_str()) > 1)
+        {
+            maxT = atoi(value.c_str());
+        }
+        else if (name == "--maxTs" && atoi(value.c_str()) > 0)
+        {
+            maxTs = atoi(value.c_str());
+        }
+        else if (name == "--maxD" && atoi(value.c_str()) > 0)
+        {
+            maxD = atoi(value.c_str());
+        }
+        else if (name == "--maxH" && atoi(value.c_str()) > 0)
+        {
+            maxH = atoi(value.c_str());
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << opt << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+} // end init_options()
+
+
+/* LISTEN ON THE SOCKET; returns its descriptor */
+int init_socket()
+{
+    int fd,probe;
+    struct sockaddr_un addr;
+
+    if (socketPath.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Socket path too long: " << socketPath << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    // a socket file nobody answers on is left over from a server that died
+    probe = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        std::cerr << "A server is already listening on " << socketPath << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    close(probe);
+    unlink(socketPath.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0)
+    {
+        std::cerr << "Cannot listen on " << socketPath << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return fd;
+} // end init_socket()
+
+
+
+/* A NEW MODEL OF THE SERVER'S GRID AND SETTINGS AT THE PARAMETERS p */
+Entry *NewEntry(const double p[6])
+{
+    Entry *e = new Entry;
+    Model &m = e->model;
+
+    m.pLeave = p[0];
+    m.pArrive = p[1];
+    m.pAttack = p[2];
+    m.alpha = p[3];
+    m.Kmort = p[4];
+    m.Kfec = p[5];
+    m.maxT = maxT;
+    m.maxTs = maxTs;
+    m.maxD = maxD;
+    m.maxH = maxH;
+    m.precision = "double";
+    m.inPlace = inPlace;
+    m.blocked = blocked;
+    m.tileT = tileT;
+    m.fwdMark = 0;
+    m.solved = false;
+    m.converged = false;
+    m.forward = false;
+    m.i = 0;
+    m.totfitdiff = 0.0;
+    m.predDeaths = 0.0;
+    m.damageDeaths = 0.0;
+    m.meanT = 0.0;
+
+    // the arena of an evicted model is mapped and faulted in already
+    if (!spare.empty())
+    {
+        m.arena = spare.back();
+        spare.pop_back();
+    }
+    else
+    {
+        m.arena.base = NULL;
+        m.arena.capacity = 0;
+        m.arena.used = 0;
+        m.arena.hugetlb = false;
+        m.arena.fd = -1;
+        m.arena.clean = 0;
+    }
+
+    e->id = nextId++;
+    e->used = nRequests;
+
+    return e;
+} // end NewEntry()
+
+
+/* CACHED MODEL WHOSE PARAMETERS ARE NEAREST TO p, OR NULL; exact is set if they are the same */
+Entry *Nearest(const double p[6], bool &exact)
+{
+    int k;
+    double dist,best;
+    Entry *near;
+    std::map<int, Entry *>::iterator it;
+
+    near = NULL;
+    best = HUGE_VAL;
+
+    for (it=models.begin();it!=models.end();++it)
+    {
+        const Model &m = it->second->model;
+        const double q[6] = {m.pLeave, m.pArrive, m.pAttack, m.alpha, m.Kmort, m.Kfec};
+
+        dist = 0.0;
+
+        for (k=0;k<6;++k) dist += fabs(p[k] - q[k]);
+
+        if (dist < best)
+        {
+            best = dist;
+            near = it->second;
+        }
+    }
+
+    exact = near != NULL && best == 0.0;
+
+    return near;
+} // end Nearest()
+
+
+/* DROP THE LEAST RECENTLY USED MODELS BEYOND THE CACHE SIZE, KEEPING keep */
+void Evict(Entry *keep)
+{
+    std::map<int, Entry *>::iterator it,oldest;
+
+    while ((int)models.size() > cacheSize)
+    {
+        oldest = models.end();
+
+        for (it=models.begin();it!=models.end();++it)
+        {
+            if (it->second == keep) continue;
+            if (oldest == models.end() || it->second->used < oldest->second->used) oldest = it;
+        }
+
+        spare.push_back(oldest->second->model.arena);
+        delete oldest->second;
+        models.erase(oldest);
+    }
+} // end Evict()
+
+
+/* MODEL id, OR NULL WITH AN ERROR IN reply */
+Entry *Find(const std::string &arg, std::ostringstream &reply)
+{
+    std::map<int, Entry *>::iterator it;
+
+    it = models.find(atoi(arg.c_str()));
+
+    if (arg.empty() || it == models.end())
+    {
+        reply << "error no model " << arg;
+        return NULL;
+    }
+
+    it->second->used = nRequests;
+
+    return it->second;
+} // end Find()
+
+
+/* SOLVE AT THE PARAMETERS p, FROM THE NEAREST CACHED SOLUTION */
+void DoSolve(const double p[6], std::ostringstream &reply)
+{
+    bool exact;
+    double secs;
+    Entry *e,*warm;
+    std::chrono::steady_clock::time_point start;
+
+    warm = warmStart ? Nearest(p, exact) : NULL;
+
+    if (warm != NULL && exact)
+    {
+        ++nHits;
+        warm->used = nRequests;
+        reply << "ok id=" << warm->id << " converged=" << warm->model.converged << " iterations=" << warm->model.i << " warm=- hit=1 seconds=0";
+        return;
+    }
+
+    start = std::chrono::steady_clock::now();
+
+    e = NewEntry(p);
+    ModelSolve(e->model, warm != NULL ? &warm->model : NULL);
+
+    // given up by the watchdog, or no room for it: nothing worth keeping
+    if (!e->model.solved)
+    {
+        reply << "error " << failKind << " at iteration " << e->model.i << ": " << failDetail;
+        spare.push_back(e->model.arena);
+        delete e;
+        return;
+    }
+
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ++nSolves;
+    if (warm != NULL) ++nWarm;
+
+    reply << "ok id=" << e->id << " converged=" << e->model.converged << " iterations=" << e->model.i << " warm=";
+    if (warm != NULL) reply << warm->id; else reply << "-";
+    reply << " hit=0 seconds=" << std::setprecision(3) << secs;
+
+    // which may well be the model it started from
+    models[e->id] = e;
+    Evict(e);
+} // end DoSolve()
+
+
+/* FORWARD CALCULATION OF A SOLVED MODEL */
+void DoForward(Entry *e, std::ostringstream &reply)
+{
+    ModelForward(e->model);
+
+    reply << "ok id=" << e->id << std::setprecision(12) << " predDeaths=" << e->model.predDeaths << " damageDeaths=" << e->model.damageDeaths;
+} // end DoForward()
+
+
+/* SIMULATED LIFE UNDER A SOLVED MODEL */
+void DoSimulate(Entry *e, unsigned int seed, std::ostringstream &reply)
+{
+    reply << "ok id=" << e->id << " rows=" << ModelSimulate(e->model, seed);
+} // end DoSimulate()
+
+
+/* PAIRED SIMULATION OF n LIVES UNDER EACH OF TWO SOLVED MODELS */
+void DoCompare(Entry *a, Entry *b, long n, unsigned int seed, std::ostringstream &reply)
+{
+    int k;
+    std::vector<Life> livesA,livesB;
+    PairedStat r[2];
+
+    if (n < 2)
+    {
+        reply << "error at least two lives are needed for a confidence interval";
+        return;
+    }
+
+    ModelLives(a->model, seed, n, livesA);
+    ModelLives(b->model, seed, n, livesB);
+
+    ComparePaired(livesA, livesB, r[0], r[1]);
+
+    reply << "ok a=" << a->id << " b=" << b->id << " n=" << n << std::setprecision(12);
+
+    for (k=0;k<2;++k)
+    {
+        reply << (k == 0 ? " repro=" : " lifespan=") << r[k].meanA << "," << r[k].meanB << "," << r[k].diff
+            << "," << r[k].se << "," << r[k].lo << "," << r[k].hi << "," << r[k].seUnpaired;
+    }
+} // end DoCompare()
+
+
+/* COPY AN ARRAY OF A MODEL INTO A NEW MEMFD, C ORDER; returns the descriptor, or -1 with an error in reply */
+int DoGet(Entry *e, const std::string &name, std::ostringstream &reply)
+{
+    int fd,t,ts,d;
+    size_t bytes;
+    char *p;
+    const Model &m = e->model;
+    const Tensor4<double> *A;
+    std::ostringstream shape;
+
+    if (name == "hormone")
+    {
+        shape << m.maxT << "," << m.maxTs << "," << m.maxD + 1;
+        bytes = m.hormone.size() * sizeof(int);
+    }
+    else if (name == "W" || (name == "F" && m.forward))
+    {
+        shape << m.maxT << "," << m.maxTs << "," << m.maxD + 1 << "," << m.maxH;
+        bytes = Tensor4<double>::Bytes();
+    }
+    else if (name == "sim" && !m.sim.empty())
+    {
+        shape << m.sim.size() / simColumns << "," << simColumns;
+        bytes = m.sim.size() * sizeof(int);
+    }
+    else
+    {
+        reply << "error no array " << name << " in model " << e->id << (name == "F" || name == "sim" ? " yet" : "");
+        return -1;
+    }
+
+    fd = memfd_create("stress_damage", MFD_CLOEXEC);
+
+    if (fd < 0 || ftruncate(fd, bytes) != 0)
+    {
+        if (fd >= 0) close(fd);
+        reply << "error cannot create shared memory of " << bytes << " bytes";
+        return -1;
+    }
+
+    p = (char *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (p == MAP_FAILED)
+    {
+        close(fd);
+        reply << "error cannot map shared memory of " << bytes << " bytes";
+        return -1;
+    }
+
+    if (name == "hormone")
+    {
+        memcpy(p, m.hormone.data, bytes);
+    }
+    else if (name == "sim")
+    {
+        memcpy(p, &m.sim[0], bytes);
+    }
+    else
+    {
+        // row by row, as the layout of the model may be blocked
+        A = name == "W" ? &m.S.W : &m.S.F;
+
+        for (t=0;t<m.maxT;++t)
+        {
+            for (ts=0;ts<m.maxTs;++ts)
+            {
+                for (d=0;d<=m.maxD;++d)
+                {
+                    memcpy(p + ((size_t(t)*m.maxTs + ts)*(m.maxD+1) + d)*m.maxH*sizeof(double),
+                            A->data + t*A->sT + ts*A->sTs + d*A->sD, m.maxH*sizeof(double));
+                }
+            }
+        }
+    }
+
+    munmap(p, bytes);
+
+    reply << "ok id=" << e->id << " array=" << name << " dtype=" << (name == "W" || name == "F" ? "float64" : "int32") << " shape=" << shape.str();
+
+    return fd;
+} // end DoGet()
+
+
+/* CARRY OUT ONE REQUEST LINE; returns the reply, and in fd a descriptor to pass along with it, or -1 */
+std::string Request(const std::string &line, int &fd)
+{
+    int k;
+    double p[6];
+    std::string verb,arg,extra;
+    std::istringstream in(line);
+    std::ostringstream reply;
+    std::map<int, Entry *>::iterator it;
+    Entry *e;
+
+    fd = -1;
+    ++nRequests;
+
+    in >> verb;
+
+    if (verb == "solve")
+    {
+        for (k=0;k<6 && in >> p[k];++k) {}
+
+        if (k < 6 || !(in >> std::ws).eof())
+        {
+            reply << "error expected solve pLeave pArrive pAttack alpha Kmort Kfec";
+        }
+        else if (!CheckParams(p).empty())
+        {
+            reply << "error " << CheckParams(p);
+        }
+        else
+        {
+            DoSolve(p, reply);
+        }
+    }
+    else if (verb == "forward" || verb == "simulate" || verb == "get" || verb == "drop")
+    {
+        in >> arg >> extra;
+
+        if ((e = Find(arg, reply)) == NULL) {}
+        else if (verb == "forward") DoForward(e, reply);
+        else if (verb == "simulate") DoSimulate(e, strtoul(extra.c_str(), NULL, 10), reply);
+        else if (verb == "get") fd = DoGet(e, extra, reply);
+        else
+        {
+            spare.push_back(e->model.arena);
+            models.erase(e->id);
+            reply << "ok id=" << e->id;
+            delete e;
+        }
+    }
+    else if (verb == "compare")
+    {
+        Entry *b;
+        long n;
+        unsigned int seed;
+
+        in >> arg >> extra >> n >> seed;
+
+        if (in.fail() || !(in >> std::ws).eof())
+        {
+            reply << "error expected compare ID ID N SEED";
+        }
+        else if ((e = Find(arg, reply)) != NULL && (b = Find(extra, reply)) != NULL)
+        {
+            DoCompare(e, b, n, seed, reply);
+        }
+    }
+    else if (verb == "stats")
+    {
+        reply << "ok models=" << models.size() << " ids=";
+
+        for (it=models.begin();it!=models.end();++it)
+        {
+            reply << (it == models.begin() ? "" : ",") << it->first;
+        }
+
+        reply << " solves=" << nSolves << " warm=" << nWarm << " hits=" << nHits;
+    }
+    else if (verb == "shutdown")
+    {
+        stop = 1;
+        reply << "ok";
+    }
+    else
+    {
+        reply << "error unknown request " << verb;
+    }
+
+    return reply.str() + "\n";
+} // end Request()
+
+
+/* SEND reply, AND fd WITH IT IF IT IS NOT -1; returns false if the client has gone */
+bool Reply(int client, const std::string &reply, int fd)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(sizeof(int))];
+    size_t sent;
+    ssize_t n;
+
+    memset(&msg, 0, sizeof(msg));
+    sent = 0;
+
+    while (sent < reply.size())
+    {
+        iov.iov_base = (void *)(reply.data() + sent);
+        iov.iov_len = reply.size() - sent;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        // the descriptor rides on the first bytes of the reply
+        if (fd >= 0 && sent == 0)
+        {
+            memset(control, 0, sizeof(control));
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+        }
+        else
+        {
+            msg.msg_control = NULL;
+            msg.msg_controllen = 0;
+        }
+
+        n = sendmsg(client, &msg, MSG_NOSIGNAL);
+
+        if (n <= 0) return false;
+
+        sent += n;
+    }
+
+    return true;
+} // end Reply()
+
+
+/* MAIN PROGRAM */
+int main(int argc, char** argv)
+{
+    int listener,k,fd;
+    ssize_t n;
+    size_t eol;
+    char buffer[4096];
+    bool gone;
+    std::string line,reply;
+    std::vector<Client> clients;
+    std::vector<struct pollfd> watch;
+    std::map<int, Entry *>::iterator it;
+
+    init_options(argc, argv);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    // the team is started once for every request to come
+    TeamStart(nThreads, std::vector<int>());
+
+    listener = init_socket();
+
+    std::cout << "serving on " << socketPath << ", grid " << maxT << " x " << maxTs << " x " << maxD + 1 << " x " << maxH
+        << ", " << cacheSize << " models cached, " << team.n << " threads" << std::endl;
+
+    while (!stop)
+    {
+        watch.assign(1, pollfd());
+        watch[0].fd = listener;
+        watch[0].events = POLLIN;
+
+        for (k=0;k<(int)clients.size();++k)
+        {
+            struct pollfd w = {clients[k].fd, POLLIN, 0};
+            watch.push_back(w);
+        }
+
+        if (poll(&watch[0], watch.size(), -1) < 0) continue; // interrupted by a signal
+
+        if (watch[0].revents & POLLIN)
+        {
+            fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+
+            if (fd >= 0)
+            {
+                Client c = {fd, ""};
+                clients.push_back(c);
+            }
+        }
+
+        // clients from the back, so that those that go can be erased
+        for (k=(int)clients.size()-1;k>=0 && !stop;--k)
+        {
+            if (!(watch[k+1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            n = read(clients[k].fd, buffer, sizeof(buffer));
+            gone = n <= 0;
+
+            if (n > 0) clients[k].in.append(buffer, n);
+
+            // requests are carried out one at a time, as the engine is global
+            while (!gone && (eol = clients[k].in.find('\n')) != std::string::npos)
+            {
+                line = clients[k].in.substr(0, eol);
+                clients[k].in.erase(0, eol + 1);
+
+                reply = Request(line, fd);
+                gone = !Reply(clients[k].fd, reply, fd);
+
+                if (fd >= 0) close(fd);
+            }
+
+            if (gone)
+            {
+                close(clients[k].fd);
+                clients.erase(clients.begin() + k);
+            }
+        }
+    }
+
+    for (k=0;k<(int)clients.size();++k) close(clients[k].fd);
+
+    close(listener);
+    unlink(socketPath.c_str());
+
+    for (it=models.begin();it!=models.end();++it)
+    {
+        ModelFree(it->second->model);
+        delete it->second;
+    }
+
+    TeamStop();
+
+    std::cout << "served " << nRequests << " requests: " << nSolves << " solves, " << nWarm << " warm, " << nHits << " from the cache" << std::endl;
+
+    return EXIT_SUCCESS;
+}
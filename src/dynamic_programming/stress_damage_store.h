@@ -0,0 +1,215 @@
+/* **********************************************************************************
+ * Strategy store of the seasonal model: the optimal hormone levels of many
+ * parameter points in one file, written by stress_damage_lh.exe --store=FILE,
+ * and read here by simulators that need them without parsing stressL*.txt.
+ *
+ * Layout, all offsets in bytes from the start of the file:
+ *
+ *   0              sd_store_header
+ *   index_offset   sd_store_entry [capacity]: parameters of point k
+ *   data_offset    int16_t [capacity][stride/2]: hormone[t][ts][d] of point k,
+ *                  starting at data_offset + k*stride
+ *
+ * A packed store, made with --pack as well, has SD_STORE_PACKED in flags and
+ * holds each point in the encoding of stress_damage_codec.h instead. Such
+ * points differ in length, so they follow each other from data_offset on,
+ * and the index entry of each gives where it starts.
+ *
+ * Points are appended, and count goes up only once a point is complete. A
+ * reader maps the whole file once and sees the points stored by then;
+ * hormone levels of a plain store are then found in O(1), while those of a
+ * packed store are unpacked a point at a time.
+ *
+ * Header only, C or C++:
+ *
+ *   sd_store s;
+ *   if (sd_store_open(&s, "strategies.sds") == 0)
+ *   {
+ *       long k = sd_store_find(&s, params);
+ *       int h = sd_store_hormone(&s, k, t, ts, d);      (plain stores)
+ *       sd_store_unpack(&s, k, levels);                  (either kind)
+ *       sd_store_close(&s);
+ *   }
+ * ********************************************************************************** */
+
+#ifndef STRESS_DAMAGE_STORE_H
+#define STRESS_DAMAGE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stress_damage_codec.h"
+
+#define SD_STORE_MAGIC "SDSTORE"
+#define SD_STORE_VERSION 1
+#define SD_STORE_VERSION_PACKED 2   /* so that readers of plain stores only turn packed ones away */
+#define SD_STORE_PACKED 1           /* flags: points are packed */
+
+typedef struct sd_store_header
+{
+    char magic[8];          /* SD_STORE_MAGIC */
+    uint32_t version;       /* SD_STORE_VERSION */
+    int32_t maxT;           /* extents of hormone[t][ts][d] */
+    int32_t maxTs;
+    int32_t maxD;           /* d = 0, ..., maxD */
+    int32_t maxH;           /* hormone levels are 0, ..., maxH */
+    uint32_t flags;         /* SD_STORE_PACKED, or 0 */
+    uint64_t capacity;      /* points the index has room for */
+    uint64_t count;         /* points stored */
+    uint64_t stride;        /* bytes from one point's hormone levels to the next; 0 if packed */
+    uint64_t index_offset;
+    uint64_t data_offset;
+} sd_store_header;
+
+typedef struct sd_store_entry
+{
+    double params[6];       /* pLeave, pArrive, pAttack, alpha, Kmort, Kfec */
+    int32_t iterations;     /* of the value iteration */
+    int32_t converged;      /* nonzero if it converged */
+    uint64_t offset;        /* packed stores: where the point starts in the file; 0 otherwise */
+} sd_store_entry;
+
+typedef struct sd_store
+{
+    const char *base;       /* the file, mapped */
+    size_t bytes;
+    const sd_store_header *header;
+    const sd_store_entry *index;
+    long count;             /* points stored when it was opened; later ones are not mapped */
+} sd_store;
+
+
+/* map the store at path; returns 0, or -1 if it cannot be read or is not a store */
+static inline int sd_store_open(sd_store *s, const char *path)
+{
+    int fd;
+    struct stat info;
+    void *p;
+
+    s->base = NULL;
+
+    fd = open(path, O_RDONLY);
+
+    if (fd < 0) return -1;
+
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(sd_store_header))
+    {
+        close(fd);
+        return -1;
+    }
+
+    p = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED) return -1;
+
+    s->base = (const char *)p;
+    s->bytes = info.st_size;
+    s->header = (const sd_store_header *)p;
+    s->index = (const sd_store_entry *)(s->base + s->header->index_offset);
+
+    if (memcmp(s->header->magic, SD_STORE_MAGIC, sizeof(SD_STORE_MAGIC)) != 0
+            || s->header->version != (s->header->flags & SD_STORE_PACKED ? SD_STORE_VERSION_PACKED : SD_STORE_VERSION)
+            || s->header->index_offset + s->header->count * sizeof(sd_store_entry) > s->bytes
+            || (s->header->flags & SD_STORE_PACKED ? s->header->count > 0 && s->index[s->header->count - 1].offset >= s->bytes
+                : s->header->data_offset + s->header->count * s->header->stride > s->bytes))
+    {
+        munmap(p, info.st_size);
+        s->base = NULL;
+        return -1;
+    }
+
+    s->count = (long)s->header->count;
+
+    return 0;
+}
+
+
+static inline void sd_store_close(sd_store *s)
+{
+    if (s->base != NULL) munmap((void *)s->base, s->bytes);
+    s->base = NULL;
+}
+
+
+/* number of points in the store */
+static inline long sd_store_count(const sd_store *s)
+{
+    return s->count;
+}
+
+
+/* index of the point with parameters params, or -1 */
+static inline long sd_store_find(const sd_store *s, const double params[6])
+{
+    long k;
+    int j;
+
+    for (k = 0; k < s->count; ++k)
+    {
+        for (j = 0; j < 6 && s->index[k].params[j] == params[j]; ++j) {}
+
+        if (j == 6) return k;
+    }
+
+    return -1;
+}
+
+
+/* whether the points are packed */
+static inline int sd_store_packed(const sd_store *s)
+{
+    return (s->header->flags & SD_STORE_PACKED) != 0;
+}
+
+
+/* hormone levels of point k of a plain store, indexed [(t*maxTs + ts)*(maxD+1) + d]; NULL for a packed store */
+static inline const int16_t *sd_store_strategy(const sd_store *s, long k)
+{
+    if (sd_store_packed(s)) return NULL;
+
+    return (const int16_t *)(s->base + s->header->data_offset + (uint64_t)k * s->header->stride);
+}
+
+
+/* optimal hormone level of point k of a plain store at t, ts and d */
+static inline int sd_store_hormone(const sd_store *s, long k, int t, int ts, int d)
+{
+    return sd_store_strategy(s, k)[((size_t)t * s->header->maxTs + ts) * (s->header->maxD + 1) + d];
+}
+
+
+/* hormone levels of point k of either kind of store into levels[maxT*maxTs*(maxD+1)],
+   indexed as by sd_store_strategy(); returns 0, or -1 if the point is damaged */
+static inline int sd_store_unpack(const sd_store *s, long k, int32_t *levels)
+{
+    const int16_t *plain;
+    uint64_t offset;
+    long nlines;
+    size_t j,n;
+
+    nlines = (long)s->header->maxTs * (s->header->maxD + 1);
+
+    if (!sd_store_packed(s))
+    {
+        plain = sd_store_strategy(s, k);
+        n = (size_t)s->header->maxT * nlines;
+
+        for (j = 0; j < n; ++j) levels[j] = plain[j];
+
+        return 0;
+    }
+
+    offset = s->index[k].offset;
+
+    if (offset < s->header->data_offset || offset >= s->bytes) return -1;
+
+    return sd_unpack((const unsigned char *)s->base + offset, s->bytes - offset, nlines, s->header->maxT, levels) < 0 ? -1 : 0;
+}
+
+#endif /* STRESS_DAMAGE_STORE_H */
@@ -1,6 +1,12 @@
 #!/usr/bin/env python3
 import numpy as np
+import os
 import os.path
+import glob
+import re
+import subprocess
+import sys
+import time
 
 autocorr = [ 0, 0.1, 0.3, 0.5, 0.7, 0.9 ]
 risk = [ 0.05, 0.1, 0.2 ]
@@ -31,13 +37,128 @@ the_dir = "./"
 
 background = True
 
+# threads per parameter point; more than one also pins them
+threads = 1
+
+# processes solving points at once, one per core, each with its threads
+slots = max(1, (os.cpu_count() or 1) // threads)
+
+# NUMA nodes of this machine; points are spread over them round robin,
+# so that each solve runs and allocates on a single socket
+nodes = sorted(int(re.search(r"node(\d+)$", n).group(1))
+        for n in glob.glob("/sys/devices/system/node/node[0-9]*"))
+
+# write the points to job files, one per slot, each solved by a single
+# background process (stress_damage_lh.exe --jobs=...) on the node of its
+# slot, rather than one process per point
+jobs = True
+
+# alternatively, put the points in a work queue directory that any number
+# of workers, on this machine or others sharing the directory, drain
+# (stress_damage_lh.exe --queue=...); jobs of a crashed worker are redone
+queue = None # e.g. "queue"
+
+# alternatively, run the points from here, as many at a time as there are
+# cores for and as fit in this much memory, taking the largest first and
+# filling the cores left over with smaller ones; their footprint and peak
+# memory go to sweep_results.txt
+budget = None # in MB, e.g. 48 * 1024
+
+# solver options to sweep over as well when running the points from here,
+# e.g. [ "", "--maxTs=50 --fwdcalc" ]; they set how much memory a point takes
+options = [ "" ]
+
+# memory of a solver process beyond its arrays: code, tables and the like
+overhead = 32 # MB
+
+job_files = {}
+
 ctr = 1
 
+# bytes the solver arrays of a point take with these options
+def footprint(opts):
+    out = subprocess.run([os.path.join(the_dir,exe), "--footprint"] + opts.split()
+            ,capture_output=True, text=True, check=True).stdout
+
+    return int(re.search(r"^footprint\t(\d+)$", out, re.MULTILINE).group(1))
+
+# run the points [ (params, opts) ], admitting them by memory
+def run_budget(points):
+
+    thread_opts = ("--threads=" + str(threads) + " --pin ") if threads > 1 else ""
+
+    sizes = { opts : footprint(thread_opts + opts) / 2**20 + overhead for opts in set(o for p, o in points) }
+
+    # largest first, so that the small ones are left to fill the gaps
+    pending = sorted(points, key=lambda point: -sizes[point[1]])
+    running = {}
+    used = 0
+
+    with open("sweep_results.txt", "w") as results:
+        results.write("pLeave\tpArrive\tpAttack\talpha\tKmort\tKfec\toptions\tfootprint_MB\tpeak_rss_MB\tseconds\tstatus\n")
+
+        def record(point, peak, secs, status):
+            params, opts = point
+            results.write("\t".join(str(x) for x in params) + "\t" + opts + "\t" +
+                    str(round(sizes[opts])) + "\t" + str(peak) + "\t" + str(round(secs, 1)) + "\t" + status + "\n")
+            results.flush()
+
+        while pending or running:
+
+            # admit the largest point that still fits, while there are cores
+            k = 0
+            while k < len(pending) and len(running) < slots:
+                params, opts = pending[k]
+
+                if used + sizes[opts] > budget:
+                    k += 1
+                    continue
+
+                cmd = [os.path.join(the_dir,exe)] + [str(x) for x in params] + (thread_opts + opts).split()
+                proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL)
+                running[proc.pid] = (pending.pop(k), time.time())
+                used += sizes[opts]
+
+            if not running:
+                # whatever is left does not fit even on its own
+                for point in pending:
+                    record(point, "-", 0, "skipped: needs " + str(round(sizes[point[1]])) + " MB")
+                break
+
+            pid, status, usage = os.wait4(-1, 0)
+            point, start = running.pop(pid)
+            used -= sizes[point[1]]
+
+            # ru_maxrss is in kB on Linux
+            record(point, usage.ru_maxrss // 1024, time.time() - start,
+                    "ok" if os.waitstatus_to_exitcode(status) == 0 else "failed: exit " + str(os.waitstatus_to_exitcode(status)))
+
+            print(" ".join(str(x) for x in point[0]) + " " + point[1] + ": peak RSS " + str(usage.ru_maxrss // 1024) + " MB"
+                    + " of " + str(round(sizes[point[1]])) + " MB admitted", file=sys.stderr)
+
+if budget is not None:
+    run_budget([ ([pLA_i[0], pLA_i[1], pAttack_i, alpha, Kmort_i, Kfec_i], opts)
+        for pLA_i in pLA
+        for Kfec_i in Kfec
+        for Kmort_i in Kmort
+        for pAttack_i in pAttack
+        for opts in options ])
+    sys.exit(0)
+
 for pLA_i in pLA:
     for Kfec_i in Kfec:
         for Kmort_i in Kmort:
             for pAttack_i in pAttack:
 
+                if jobs:
+                    # a queue is filled from a single file and drained by the workers
+                    slot = (ctr - 1) % slots if queue is None else 0
+
+                    job_files.setdefault(slot, []).append(" ".join(str(x) for x in
+                        [pLA_i[0], pLA_i[1], pAttack_i, alpha, Kmort_i, Kfec_i]))
+                    ctr+=1
+                    continue
+
                 print("echo " + str(ctr))
 
                 print(os.path.join(the_dir,exe) + " " +
@@ -47,6 +168,41 @@ for pLA_i in pLA:
                         str(alpha) + " " +
                         str(Kmort_i) + " " +
                         str(Kfec_i) + " " +
+                        (("--threads=" + str(threads) + " --pin ") if threads > 1 else "") +
+                        (("--node=" + str(nodes[(ctr - 1) % len(nodes)]) + " ") if len(nodes) > 1 else "") +
                         ("&" if background else "")
                         )
                 ctr+=1
+
+# NUMA node of a slot; the slots are spread over the nodes round robin
+def slot_node(slot):
+    return nodes[slot % len(nodes)] if len(nodes) > 1 else None
+
+for slot, lines in job_files.items():
+    job_file = "jobs.txt" if len(job_files) == 1 else "jobs" + str(slot) + ".txt"
+    node = slot_node(slot)
+
+    with open(job_file, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+    if queue is not None:
+        print(os.path.join(the_dir,exe) + " --queue=" + queue + " --jobs=" + job_file)
+        continue
+
+    print(os.path.join(the_dir,exe) + " --jobs=" + job_file + " " +
+            (("--threads=" + str(threads) + " --pin ") if threads > 1 else "") +
+            (("--node=" + str(node) + " ") if node is not None else "") +
+            ("&" if background and len(job_files) > 1 else ""))
+
+# one worker per slot
+if queue is not None:
+    for slot in range(slots):
+        node = slot_node(slot)
+
+        print(os.path.join(the_dir,exe) + " --queue=" + queue + " " +
+                (("--threads=" + str(threads) + " --pin ") if threads > 1 else "") +
+                (("--node=" + str(node) + " ") if node is not None else "") +
+                ("&" if background and slots > 1 else ""))
+
+if len(job_files) > 1 or (queue is not None and slots > 1):
+    print("wait")